@@ -0,0 +1,257 @@
+/*
+             LUFA Library
+     Copyright (C) Dean Camera, 2021.
+
+  dean [at] fourwalledcubicle [dot] com
+           www.lufa-lib.org
+*/
+
+/*
+  Copyright 2021  Dean Camera (dean [at] fourwalledcubicle [dot] com)
+
+  Permission to use, copy, modify, distribute, and sell this
+  software and its documentation for any purpose is hereby granted
+  without fee, provided that the above copyright notice appear in
+  all copies and that both that the copyright notice and this
+  permission notice and warranty disclaimer appear in supporting
+  documentation, and that the name of the author not be used in
+  advertising or publicity pertaining to distribution of the
+  software without specific, written prior permission.
+
+  The author disclaims all warranties with regard to this
+  software, including all implied warranties of merchantability
+  and fitness.  In no event shall the author be liable for any
+  special, indirect or consequential damages or any damages
+  whatsoever resulting from loss of use, data or profits, whether
+  in an action of contract, negligence or other tortious action,
+  arising out of or in connection with the use or performance of
+  this software.
+*/
+
+/** \file
+ *  \brief Lock-free single producer, single consumer ring (circular) buffer of bytes.
+ *
+ *  Lock-free ring buffer, for passing bytes from one execution thread (such as an ISR) to another
+ *  (such as the main program thread) without disabling interrupts. Multiple buffers can be created of
+ *  different sizes to suit different needs.
+ *
+ *  Note that for each buffer, exactly one execution thread may insert into it and exactly one execution
+ *  thread may remove from it. If this cannot be guaranteed, the locking ring buffer in RingBuffer.h should
+ *  be used instead.
+ */
+
+/** \ingroup Group_MiscDrivers
+ *  \defgroup Group_SPSCRingBuff Lock-Free Byte Ring Buffer - LUFA/Drivers/Misc/SPSCRingBuffer.h
+ *  \brief Lock-free single producer, single consumer ring buffer of bytes.
+ *
+ *  \section Sec_SPSCRingBuff_Dependencies Module Source Dependencies
+ *  The following files must be built with any user project that uses this module:
+ *    - None
+ *
+ *  \section Sec_SPSCRingBuff_ModDescription Module Description
+ *  Lock-free ring buffer, for passing bytes from one execution thread (such as an ISR) to another
+ *  (such as the main program thread) without disabling interrupts. Multiple buffers can be created of
+ *  different sizes to suit different needs.
+ *
+ *  Unlike the buffers of \ref Group_RingBuff, no shared count is kept. Instead the producer owns a free
+ *  running input index and the consumer owns a free running output index, each of which is a single
+ *  byte and so can be read and written atomically on all supported architectures. The number of stored
+ *  bytes is the difference of the two indices, and buffer locations are found by masking, which requires
+ *  the size of the buffer to be a power of two, no larger than 128 bytes.
+ *
+ *  Note that for each buffer, exactly one execution thread may insert into it and exactly one execution
+ *  thread may remove from it. Insertion and removal may occur at the same time (via a multi-threaded ISR
+ *  based system) with no locking, as each side only ever writes its own index. If there is possibility of
+ *  two or more insertions or removals occurring at the same point in time, the locking ring buffer of
+ *  \ref Group_RingBuff should be used instead.
+ *
+ *  \section Sec_SPSCRingBuff_ExampleUsage Example Usage
+ *  The following snippet is an example of how this module may be used within a typical
+ *  application.
+ *
+ *  \code
+ *      // Create the buffer structure and its underlying storage array
+ *      SPSCRingBuffer_t Buffer;
+ *      uint8_t          BufferData[64];
+ *
+ *      // Initialize the buffer with the created storage array, before the producer is started
+ *      SPSCRingBuffer_InitBuffer(&Buffer, BufferData, sizeof(BufferData));
+ *
+ *      // In the producer (e.g. an ISR), insert data into the buffer if there is room for it
+ *      if (!(SPSCRingBuffer_IsFull(&Buffer)))
+ *        SPSCRingBuffer_Insert(&Buffer, UDR1);
+ *
+ *      // In the consumer (e.g. the main program thread), remove all currently stored data
+ *      uint8_t BufferCount = SPSCRingBuffer_GetCount(&Buffer);
+ *
+ *      while (BufferCount--)
+ *        putc(SPSCRingBuffer_Remove(&Buffer));
+ *  \endcode
+ *
+ *  @{
+ */
+
+#ifndef __SPSC_RING_BUFFER_H__
+#define __SPSC_RING_BUFFER_H__
+
+	/* Includes: */
+		#include "../../Common/Common.h"
+
+	/* Enable C linkage for C++ Compilers: */
+		#if defined(__cplusplus)
+			extern "C" {
+		#endif
+
+	/* Type Defines: */
+		/** \brief Lock-Free Ring Buffer Management Structure.
+		 *
+		 *  Type define for a new lock-free ring buffer object. Buffers should be initialized via a call to
+		 *  \ref SPSCRingBuffer_InitBuffer() before use.
+		 */
+		typedef struct
+		{
+			volatile uint8_t* Data; /**< Pointer to the start of the buffer's underlying storage array. */
+			uint8_t           Mask; /**< Size of the buffer's underlying storage array, less one. */
+			volatile uint8_t  In; /**< Free running storage index, only written by the producer. */
+			volatile uint8_t  Out; /**< Free running retrieval index, only written by the consumer. */
+		} SPSCRingBuffer_t;
+
+	/* Inline Functions: */
+		/** Initializes a lock-free ring buffer ready for use. Buffers must be initialized via this function
+		 *  before any operations are called upon them, and before the producer or consumer thread is started.
+		 *
+		 *  \param[out] Buffer   Pointer to a ring buffer structure to initialize.
+		 *  \param[out] DataPtr  Pointer to a global array that will hold the data stored into the ring buffer.
+		 *  \param[in]  Size     Number of bytes in the underlying data array, a power of two no larger than 128.
+		 */
+		static inline void SPSCRingBuffer_InitBuffer(SPSCRingBuffer_t* const Buffer,
+		                                             uint8_t* const DataPtr,
+		                                             const uint8_t Size) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2);
+		static inline void SPSCRingBuffer_InitBuffer(SPSCRingBuffer_t* const Buffer,
+		                                             uint8_t* const DataPtr,
+		                                             const uint8_t Size)
+		{
+			Buffer->Data = DataPtr;
+			Buffer->Mask = (Size - 1);
+			Buffer->In   = 0;
+			Buffer->Out  = 0;
+		}
+
+		/** Retrieves the current number of bytes stored in a particular buffer, without locking.
+		 *
+		 *  \note When called by the consumer, the returned value is the minimum number of bytes stored in the
+		 *        buffer, as the producer may insert more at any time. When called by the producer, it is the
+		 *        maximum number of bytes stored, as the consumer may remove some at any time.
+		 *
+		 *  \param[in] Buffer  Pointer to a ring buffer structure whose count is to be computed.
+		 *
+		 *  \return Number of bytes currently stored in the buffer.
+		 */
+		static inline uint8_t SPSCRingBuffer_GetCount(const SPSCRingBuffer_t* const Buffer) ATTR_WARN_UNUSED_RESULT ATTR_NON_NULL_PTR_ARG(1);
+		static inline uint8_t SPSCRingBuffer_GetCount(const SPSCRingBuffer_t* const Buffer)
+		{
+			return (uint8_t)(Buffer->In - Buffer->Out);
+		}
+
+		/** Retrieves the free space in a particular buffer, without locking.
+		 *
+		 *  \note When called by the producer, the returned value is the minimum number of bytes free in the
+		 *        buffer, and so the number of successive insertions which may safely be performed.
+		 *
+		 *  \param[in] Buffer  Pointer to a ring buffer structure whose free count is to be computed.
+		 *
+		 *  \return Number of free bytes in the buffer.
+		 */
+		static inline uint8_t SPSCRingBuffer_GetFreeCount(const SPSCRingBuffer_t* const Buffer) ATTR_WARN_UNUSED_RESULT ATTR_NON_NULL_PTR_ARG(1);
+		static inline uint8_t SPSCRingBuffer_GetFreeCount(const SPSCRingBuffer_t* const Buffer)
+		{
+			return (Buffer->Mask + 1 - SPSCRingBuffer_GetCount(Buffer));
+		}
+
+		/** Determines if the specified ring buffer contains any data. This should be tested by the consumer
+		 *  before removing data from the buffer, to ensure that the buffer does not underflow.
+		 *
+		 *  \param[in] Buffer  Pointer to a ring buffer structure to test.
+		 *
+		 *  \return Boolean \c true if the buffer contains no data, \c false otherwise.
+		 */
+		static inline bool SPSCRingBuffer_IsEmpty(const SPSCRingBuffer_t* const Buffer) ATTR_WARN_UNUSED_RESULT ATTR_NON_NULL_PTR_ARG(1);
+		static inline bool SPSCRingBuffer_IsEmpty(const SPSCRingBuffer_t* const Buffer)
+		{
+			return (Buffer->In == Buffer->Out);
+		}
+
+		/** Determines if the specified ring buffer contains any free space. This should be tested by the
+		 *  producer before storing data to the buffer, to ensure that no data is lost due to a buffer overrun.
+		 *
+		 *  \param[in] Buffer  Pointer to a ring buffer structure to test.
+		 *
+		 *  \return Boolean \c true if the buffer contains no free space, \c false otherwise.
+		 */
+		static inline bool SPSCRingBuffer_IsFull(const SPSCRingBuffer_t* const Buffer) ATTR_WARN_UNUSED_RESULT ATTR_NON_NULL_PTR_ARG(1);
+		static inline bool SPSCRingBuffer_IsFull(const SPSCRingBuffer_t* const Buffer)
+		{
+			return (SPSCRingBuffer_GetCount(Buffer) > Buffer->Mask);
+		}
+
+		/** Inserts an element into the ring buffer. The stored byte is written before the input index is
+		 *  advanced, so the consumer never sees an index which refers to data that has not yet been stored.
+		 *
+		 *  \warning Only one execution thread (main program thread or an ISR) may insert into a single buffer,
+		 *           and it must first check that the buffer is not full.
+		 *
+		 *  \param[in,out] Buffer  Pointer to a ring buffer structure to insert into.
+		 *  \param[in]     Data    Data element to insert into the buffer.
+		 */
+		static inline void SPSCRingBuffer_Insert(SPSCRingBuffer_t* const Buffer,
+		                                         const uint8_t Data) ATTR_NON_NULL_PTR_ARG(1);
+		static inline void SPSCRingBuffer_Insert(SPSCRingBuffer_t* const Buffer,
+		                                         const uint8_t Data)
+		{
+			uint8_t In = Buffer->In;
+
+			Buffer->Data[In & Buffer->Mask] = Data;
+			Buffer->In = (In + 1);
+		}
+
+		/** Removes an element from the ring buffer. The byte is read before the output index is advanced,
+		 *  so the producer never overwrites a location that has not yet been read.
+		 *
+		 *  \warning Only one execution thread (main program thread or an ISR) may remove from a single buffer,
+		 *           and it must first check that the buffer is not empty.
+		 *
+		 *  \param[in,out] Buffer  Pointer to a ring buffer structure to retrieve from.
+		 *
+		 *  \return Next data element stored in the buffer.
+		 */
+		static inline uint8_t SPSCRingBuffer_Remove(SPSCRingBuffer_t* const Buffer) ATTR_NON_NULL_PTR_ARG(1);
+		static inline uint8_t SPSCRingBuffer_Remove(SPSCRingBuffer_t* const Buffer)
+		{
+			uint8_t Out  = Buffer->Out;
+			uint8_t Data = Buffer->Data[Out & Buffer->Mask];
+
+			Buffer->Out = (Out + 1);
+
+			return Data;
+		}
+
+		/** Returns the next element stored in the ring buffer, without removing it.
+		 *
+		 *  \param[in] Buffer  Pointer to a ring buffer structure to retrieve from.
+		 *
+		 *  \return Next data element stored in the buffer.
+		 */
+		static inline uint8_t SPSCRingBuffer_Peek(const SPSCRingBuffer_t* const Buffer) ATTR_WARN_UNUSED_RESULT ATTR_NON_NULL_PTR_ARG(1);
+		static inline uint8_t SPSCRingBuffer_Peek(const SPSCRingBuffer_t* const Buffer)
+		{
+			return Buffer->Data[Buffer->Out & Buffer->Mask];
+		}
+
+	/* Disable C linkage for C++ Compilers: */
+		#if defined(__cplusplus)
+			}
+		#endif
+
+#endif
+
+/** @} */
@@ -198,7 +198,17 @@ void HID_Device_USBTask(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo)
 			if (ReportID)
 			  Endpoint_Write_8(ReportID);
 
-			Endpoint_Write_Stream_LE(ReportINData, ReportINSize, NULL);
+			/* Short reports fit in the bank, which was already checked to be ready above, so they can be written
+			 * directly, without the overhead of the stream functions. */
+			if ((ReportINSize <= ENDPOINT_UNROLLED_WRITE_MAX) &&
+			    ((ReportINSize + (ReportID ? 1 : 0)) <= HIDInterfaceInfo->Config.ReportINEndpoint.Size))
+			{
+				Endpoint_Write_Block_LE(ReportINData, ReportINSize);
+			}
+			else
+			{
+				Endpoint_Write_Stream_LE(ReportINData, ReportINSize, NULL);
+			}
 
 			Endpoint_ClearIN();
 		}
@@ -119,6 +119,48 @@
 			#include "XMEGA/Endpoint_XMEGA.h"
 		#endif
 
+	/* Public Interface - May be used in end-application: */
+		/* Macros: */
+			/** Largest number of bytes which may be written in one call to \ref Endpoint_Write_Block_LE(). */
+			#define ENDPOINT_UNROLLED_WRITE_MAX             8
+
+		/* Inline Functions: */
+			/** Writes a short block of bytes to the currently selected endpoint's bank, for IN direction endpoints,
+			 *  as a straight-line sequence of \ref Endpoint_Write_8() calls. Unlike \ref Endpoint_Write_Stream_LE(),
+			 *  no readiness or bank-full checks are made and no packets are sent, so the caller must already have
+			 *  checked that the bank is ready to accept data via \ref Endpoint_IsReadWriteAllowed(), and that it has
+			 *  room for the whole block.
+			 *
+			 *  When \c Length is a compile time constant the writes are fully unrolled. Otherwise the unrolled
+			 *  sequence is entered through a switch, which the compiler turns into a single computed jump only when
+			 *  jump tables are enabled. Builds with \c -fno-jump-tables, which is the DMBS default (\c JUMP_TABLES=N),
+			 *  get a chain of up to \ref ENDPOINT_UNROLLED_WRITE_MAX compares and branches instead.
+			 *
+			 *  \ingroup Group_EndpointPrimitiveRW
+			 *
+			 *  \param[in] Buffer  Pointer to the source data buffer to read from.
+			 *  \param[in] Length  Number of bytes to write, no more than \ref ENDPOINT_UNROLLED_WRITE_MAX.
+			 */
+			static inline void Endpoint_Write_Block_LE(const void* const Buffer,
+			                                           const uint8_t Length) ATTR_ALWAYS_INLINE ATTR_NON_NULL_PTR_ARG(1);
+			static inline void Endpoint_Write_Block_LE(const void* const Buffer,
+			                                           const uint8_t Length)
+			{
+				const uint8_t* Data = (const uint8_t*)Buffer;
+
+				switch (Length)
+				{
+					case 8: Endpoint_Write_8(*Data++); /* Fall through. */
+					case 7: Endpoint_Write_8(*Data++); /* Fall through. */
+					case 6: Endpoint_Write_8(*Data++); /* Fall through. */
+					case 5: Endpoint_Write_8(*Data++); /* Fall through. */
+					case 4: Endpoint_Write_8(*Data++); /* Fall through. */
+					case 3: Endpoint_Write_8(*Data++); /* Fall through. */
+					case 2: Endpoint_Write_8(*Data++); /* Fall through. */
+					case 1: Endpoint_Write_8(*Data);
+				}
+			}
+
 	/* Disable C linkage for C++ Compilers: */
 		#if defined(__cplusplus)
 			}
@@ -5,6 +5,13 @@
 #define FIXED_CONTROL_ENDPOINT_SIZE 8
 #define FIXED_NUM_CONFIGURATIONS 1
 #define USB_DEVICE_ONLY
+
+/* Service control requests from the USB interrupt, so that they're
+ * handled promptly, even while the main loop is busy, e.g. reading
+ * the sensor, or blocked in printf.  See usb.c for what this implies
+ * for the callbacks. */
+
+#define INTERRUPT_CONTROL_ENDPOINT
 #define USE_STATIC_OPTIONS (USB_DEVICE_OPT_FULLSPEED \
                             | USB_OPT_REG_ENABLED \
                             | USB_OPT_AUTO_PLL)
@@ -1,5 +1,6 @@
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
@@ -7,58 +8,389 @@
 
 static double axes[4];
 
+/* The scale of each axis.  (One of the pointer axes is flipped since,
+ * this being a trackball, the sensor is mounted upside-down.) */
+
+static const double sensitivities[4] = {
+    POINTER_SENSITIVITY, -POINTER_SENSITIVITY,
+    WHEEL_SENSITIVITY_X, WHEEL_SENSITIVITY_Y
+};
+
+/* The number of high-resolution wheel counts per notch, when the host
+ * has enabled the resolution multiplier (see reports.h). */
+
+#define NOTCH 120
+
+static volatile uint8_t multiplier;
+
+/* Wheel motion, in high-resolution counts, left over from reporting
+ * whole notches (see detent), and the way wheel motion was last
+ * reported: whether in whole notches, and in what unit. */
+
+static int32_t residue[2];
+static bool notched;
+static int16_t unit;
+
+#ifdef SMOOTHING_FRAMES
+static int32_t input[2], pending[2][SMOOTHING_FRAMES];
+static uint8_t head;
+
+/* An adaptive smoothing filter for pointer motion, to suppress
+ * shimmer due to quantization noise on slow movements.
+ *
+ * Each frame's input (i.e. the motion sensed since the previous
+ * report) is spread over the following SMOOTHING_FRAMES output
+ * frames, with exponentially decaying weights, the last frame getting
+ * whatever is left.  The rate of decay alpha depends on speed: at
+ * rest it's SMOOTHING_ALPHA (in 1/256ths) and it rises linearly to
+ * 1 (i.e. no smoothing) at SMOOTHING_SPEED counts per frame.  Since
+ * all input is fully accounted for within SMOOTHING_FRAMES frames,
+ * no motion is lost and the added delay is bounded by
+ * SMOOTHING_FRAMES - 1 frames.  All arithmetic is carried out in
+ * fixed point, with 8 fractional bits. */
+
+static void smooth(void)
+{
+    static int32_t v;
+
+    /* Estimate the speed, smoothing it a little as well, to keep
+     * alpha from fluctuating from frame to frame. */
+
+    v = (v + labs(input[0]) + labs(input[1])) / 2;
+
+    const int32_t alpha = (
+        v >= SMOOTHING_SPEED
+        ? 256
+        : SMOOTHING_ALPHA + (256 - SMOOTHING_ALPHA) * v / SMOOTHING_SPEED);
+
+    for (uint8_t i = 0; i < 2; i++) {
+        int32_t r = input[i] * 256;
+        uint8_t k = head;
+
+        /* Spread the input over the pending frames.  (When alpha is
+         * 1, the first frame gets it all, so skip the
+         * multiplications, which could also overflow at high
+         * speed.) */
+
+        if (alpha < 256) {
+            for (uint8_t j = 0; j < SMOOTHING_FRAMES - 1; j++) {
+                const int32_t d = r * alpha / 256;
+
+                pending[i][k] += d;
+                r -= d;
+
+                k = (k + 1) % SMOOTHING_FRAMES;
+            }
+        }
+
+        pending[i][k] += r;
+        input[i] = 0;
+
+        /* Pass on the current frame. */
+
+        axes[i] += pending[i][head] / 256.0;
+        pending[i][head] = 0;
+    }
+
+    head = (head + 1) % SMOOTHING_FRAMES;
+}
+#endif
+
+#ifdef WHEEL_ACCELERATION
+static int32_t wheel_input[2];
+
+static const uint16_t curve[][2] = {WHEEL_ACCELERATION};
+
+#define CURVE_POINTS (sizeof(curve) / sizeof(curve[0]))
+
+/* A velocity-dependent gain for wheel motion, so that slow movements
+ * scroll precisely, while fast ones cover more ground.
+ *
+ * The wheel input of each frame is multiplied by a gain, looked up
+ * in the WHEEL_ACCELERATION table, by speed, and interpolated
+ * linearly between its points, before being passed on, to be scaled
+ * by the wheel sensitivity.  The speed is estimated as for the
+ * smoothing filter.  The input, the speed and the gain are all fixed
+ * point, with 8 fractional bits. */
+
+static void accelerate(void)
+{
+    static int32_t v;
+    int32_t g;
+    uint8_t i;
+
+    v = (v + labs(wheel_input[0]) + labs(wheel_input[1])) / 2;
+
+    for (i = 0; i < CURVE_POINTS && v >= curve[i][0] * 256L; i++);
+
+    if (i == 0) {
+        g = curve[0][1];
+    } else if (i == CURVE_POINTS) {
+        g = curve[CURVE_POINTS - 1][1];
+    } else {
+        const int32_t s_0 = curve[i - 1][0], s_1 = curve[i][0];
+        const int32_t g_0 = curve[i - 1][1], g_1 = curve[i][1];
+
+        /* Find the position of v within the segment first, in
+         * 1/256ths, so as not to overflow. */
+
+        const int32_t f = (v - s_0 * 256) / (s_1 - s_0);
+
+        g = g_0 + (g_1 - g_0) * f / 256;
+    }
+
+    for (i = 0; i < 2; i++) {
+        /* Multiply the integer and fractional parts separately, so as
+         * not to overflow. */
+
+        const int32_t x = wheel_input[i];
+        const int32_t d = x / 256 * g + x % 256 * g / 256;
+
+        axes[i + 2] += d / 256.0;
+        wheel_input[i] = 0;
+    }
+}
+#endif
+
 void update_axes(int16_t delta_x, int16_t delta_y, bool scroll)
 {
+#ifdef WHEEL_ACCELERATION
+    if (scroll) {
+        wheel_input[0] += delta_x * 256L;
+        wheel_input[1] += delta_y * 256L;
+
+        return;
+    }
+#endif
+
+#ifdef SMOOTHING_FRAMES
+    if (!scroll) {
+        input[0] += delta_x;
+        input[1] += delta_y;
+
+        return;
+    }
+#endif
+
     axes[scroll * 2 + 0] += delta_x;
     axes[scroll * 2 + 1] += delta_y;
 }
 
-bool get_axes(int16_t *p)
+#ifdef TWIST_SENSOR_SS
+/* Accumulate twist, i.e. rotation of the ball about the vertical
+ * axis, as sensed by the second sensor, as vertical scroll motion.
+ * Ideally, the second sensor's X axis senses only twist, but any
+ * cross-coupling with pointer motion, due to its placement, can be
+ * cancelled out, given the pointer sensor's deltas. */
+
+void update_twist(int16_t delta, int16_t delta_x, int16_t delta_y)
+{
+    const double d = TWIST_GAIN * (delta
+                                   - TWIST_COUPLING_X * delta_x
+                                   - TWIST_COUPLING_Y * delta_y);
+
+#ifdef WHEEL_ACCELERATION
+    wheel_input[1] += (int32_t)(d * 256);
+#else
+    axes[3] += d;
+#endif
+}
+#endif
+
+/* Scale an accumulated axis value by k, to get the value to report.
+ * The result is saturated to the range of the report field, i.e. to
+ * [-limit, limit], and
+ * whatever can't be reported, either because it's a fraction of a
+ * unit, or because it doesn't fit, is scaled back and left in the
+ * accumulator, to be carried over into subsequent reports.  That
+ * way no motion is lost (or wrapped around) when it piles up, say
+ * because the host hasn't polled us for a while. */
+
+static int16_t coalesce(double *axis, const double k, const int16_t limit)
 {
-    /* Scale the sensed pointer coordinates, before passing them
-     * on. (Also flip one of the axes since, this being a trackball,
-     * the sensor is mounted upside-down.) */
+    const double x = k * *axis;
+    double i;
+
+    modf(x, &i);
+
+    if (i > limit) {
+        i = limit;
+    } else if (i < -limit) {
+        i = -limit;
+    }
+
+    *axis = (x - i) / k;
+
+    return (int16_t)i;
+}
 
-    {
-        const double x = POINTER_SENSITIVITY * axes[0];
-        const double y = POINTER_SENSITIVITY * -axes[1];
+/* Quantize wheel motion to whole notches, with hysteresis.  The
+ * motion is added to the residue *r, in high-resolution counts, which
+ * is the position of the wheel relative to the current notch.  The
+ * wheel moves on to the next notch, in either direction, once it's
+ * WHEEL_DETENT_HYSTERESIS counts past the midpoint between the two,
+ * so that it doesn't click back and forth when resting on the
+ * midpoint.  The number of notches moved, saturated to [-limit,
+ * limit], is returned. */
 
-        double ix, iy;
-        const double fx = modf(x, &ix);
-        const double fy = modf(y, &iy);
+static int16_t detent(int32_t *r, int16_t d, int16_t limit)
+{
+    const int32_t t = NOTCH / 2 + WHEEL_DETENT_HYSTERESIS;
+    int32_t n;
 
-        p[0] = (int16_t)ix;
-        p[1] = (int16_t)iy;
+    *r += d;
 
-        /* Scale any fractional remainders back and accummulate
-         * them. */
+    if (*r >= t) {
+        n = (*r - t) / NOTCH + 1;
+    } else if (*r <= -t) {
+        n = (*r + t) / NOTCH - 1;
+    } else {
+        return 0;
+    }
 
-        axes[0] = fx / POINTER_SENSITIVITY;
-        axes[1] = -fy / POINTER_SENSITIVITY;
+    if (n > limit) {
+        n = limit;
+    } else if (n < -limit) {
+        n = -limit;
     }
 
-    /* Same thing for the wheel. */
+    *r -= n * NOTCH;
 
-    {
-        const double x = WHEEL_SENSITIVITY_X * axes[2];
-        const double y = WHEEL_SENSITIVITY_Y * axes[3];
+    return (int16_t)n;
+}
+
+/* Get the motion to report, saturated to [-limit, limit], which
+ * should be INT16_MAX for report protocol and INT8_MAX for boot
+ * protocol reports.  Wheel motion is reported in high-resolution
+ * counts, if the host has enabled the resolution multiplier, and in
+ * whole notches otherwise, or if detents are emulated. */
+
+bool get_axes(int16_t *p, int16_t limit)
+{
+#ifdef SMOOTHING_FRAMES
+    smooth();
+#endif
 
-        double ix, iy;
-        const double fx = modf(x, &ix);
-        const double fy = modf(y, &iy);
+#ifdef WHEEL_ACCELERATION
+    accelerate();
+#endif
 
-        p[2] = (int16_t)ix;
-        p[3] = (int16_t)iy;
+    /* Scale the sensed pointer and wheel coordinates, before passing
+     * them on. */
 
-        axes[2] = fx / WHEEL_SENSITIVITY_X;
-        axes[3] = fy / WHEEL_SENSITIVITY_Y;
+    const bool was_notched = notched;
+    bool q = false;
+
+    unit = multiplier ? NOTCH : 1;
+
+#ifdef WHEEL_DETENTS
+    notched = true;
+#else
+    notched = (unit == 1);
+#endif
+
+    /* If the host has just enabled the resolution multiplier, wheel
+     * motion short of a whole notch is left in the residue, which is
+     * no longer used, so return it to the accumulators, to be
+     * reported in high-resolution counts instead.  This is done here,
+     * rather than when the multiplier is set, from the USB interrupt,
+     * so as not to race with the accumulators' update. */
+
+    if (was_notched && !notched) {
+        for (int i = 0; i < 2; i++) {
+            axes[i + 2] += residue[i] / sensitivities[i + 2];
+            residue[i] = 0;
+        }
     }
 
     for (int i = 0; i < 4; i++) {
-        if (p[i]) {
-            return true;
+        p[i] = coalesce(&axes[i], sensitivities[i], limit);
+
+        if (i >= 2 && notched) {
+            p[i] = detent(&residue[i - 2], p[i], limit / unit) * unit;
+        }
+
+        q = q || p[i];
+    }
+
+    return q;
+}
+
+/* Return motion, previously gotten with get_axes, that couldn't be
+ * reported after all, to be reported later instead. */
+
+void unget_axes(const int16_t *p)
+{
+    for (int i = 0; i < 4; i++) {
+        if (i >= 2 && notched) {
+            residue[i - 2] += p[i] / unit * NOTCH;
+        } else {
+            axes[i] += p[i] / sensitivities[i];
         }
     }
+}
+
+/* Only one of the pointer and scroll reports can be sent per polling
+ * interval, so, given motion p, as gotten with get_axes, and whether
+ * each report has changed, or is otherwise due to be sent, choose
+ * which to send.  If both are due, alternate between them, and return
+ * the motion of the one not sent, to be reported next time.  Only the
+ * motion of the chosen report is left in p.  Returns true for the
+ * scroll report and false for the pointer report. */
+
+bool split_axes(int16_t *p, bool pointer, bool scroll)
+{
+    static bool last;
+    int16_t q[4] = {0, 0, 0, 0};
+    const bool s = (pointer && scroll) ? !last : scroll;
+    const uint8_t j = s ? 0 : 2;
+
+    q[j] = p[j];
+    q[j + 1] = p[j + 1];
+    p[j] = p[j + 1] = 0;
+
+    unget_axes(q);
+    last = s;
+
+    return s;
+}
+
+/* Set or get the resolution multiplier's value, as set by the host
+ * through the feature report: zero for one count per notch, or one
+ * for NOTCH counts per notch. */
+
+void set_wheel_multiplier(uint8_t m)
+{
+    multiplier = m;
+}
 
-    return false;
+uint8_t get_wheel_multiplier(void)
+{
+    return multiplier;
+}
+
+/* Scale all accumulated motion by k, for instance after a change in
+ * sensor resolution. */
+
+void scale_axes(double k)
+{
+    for (int i = 0; i < 4; i++) {
+        axes[i] *= k;
+    }
+
+#ifdef WHEEL_ACCELERATION
+    for (uint8_t i = 0; i < 2; i++) {
+        wheel_input[i] *= k;
+    }
+#endif
+
+#ifdef SMOOTHING_FRAMES
+    for (uint8_t i = 0; i < 2; i++) {
+        input[i] *= k;
+
+        for (uint8_t j = 0; j < SMOOTHING_FRAMES; j++) {
+            pending[i][j] *= k;
+        }
+    }
+#endif
 }
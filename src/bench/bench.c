@@ -0,0 +1,294 @@
+/* Cycle-count benchmarks of the LUFA hot paths used by the firmware.
+ *
+ * This is a harness firmware, meant to be run under simavr (see
+ * simulate.sh), not on the device.  Each benchmark is called a number
+ * of times with interrupts disabled and timed with timer 1, running
+ * at the CPU clock, so that the counts are exact.  The cost of the
+ * timing itself is measured first and subtracted.  Results are
+ * printed to the simavr console, one "BENCH name min max" line per
+ * benchmark, after which the CPU is put to sleep with interrupts
+ * disabled, which ends the simulation.
+ *
+ * No USB host is simulated, so the device is forced into the
+ * configured state and the endpoints behave as the simulator's USB
+ * model makes them.  The counts are therefore mostly useful for
+ * comparing builds with each other, rather than as absolute figures
+ * for a live bus. */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+#include <LUFA/Drivers/USB/USB.h>
+#include <LUFA/Drivers/Misc/RingBuffer.h>
+#include <LUFA/Drivers/Misc/SPSCRingBuffer.h>
+
+#include "avr_mcu_section.h"
+
+AVR_MCU(F_CPU, "atmega32u4");
+AVR_MCU_SIMAVR_CONSOLE(&GPIOR0);
+
+#define CALLS 16
+
+#define REPORT_ID 1
+#define REPORT_SIZE 5
+#define EPADDR (ENDPOINT_DIR_IN | 1)
+#define EPSIZE 8
+
+/* Larger than CALLS, so that the ring buffers never fill up, or run
+ * empty, while being benchmarked. */
+
+#define RING_BUFFER_SIZE 32
+
+static const USB_Endpoint_Table_t endpoints[] = {
+    {EPADDR, EPSIZE, EP_TYPE_INTERRUPT, 1},
+    {ENDPOINT_DIR_IN | 2, 8, EP_TYPE_INTERRUPT, 1},
+    {ENDPOINT_DIR_OUT | 3, 16, EP_TYPE_BULK, 1},
+    {ENDPOINT_DIR_IN | 4, 16, EP_TYPE_BULK, 1},
+};
+
+static uint8_t report[REPORT_SIZE];
+static uint8_t previous_report[REPORT_SIZE];
+
+static RingBuffer_t ring_buffer;
+static SPSCRingBuffer_t spsc_ring_buffer;
+static uint8_t ring_buffer_data[RING_BUFFER_SIZE];
+static uint8_t spsc_ring_buffer_data[RING_BUFFER_SIZE];
+static volatile uint8_t sink;
+
+static USB_ClassInfo_HID_Device_t HID_Interface = {
+    .Config =
+    {
+        .InterfaceNumber = 0,
+        .ReportINEndpoint =
+        {
+            .Address = EPADDR,
+            .Size = EPSIZE,
+            .Banks = 1,
+        },
+        .PrevReportINBuffer = previous_report,
+        .PrevReportINBufferSize = sizeof(previous_report),
+    },
+};
+
+/* Time a statement, in cycles. */
+
+#define TIME(statement) ({                      \
+            GCC_MEMORY_BARRIER();               \
+            const uint16_t t_0 = TCNT1;         \
+            GCC_MEMORY_BARRIER();               \
+            statement;                          \
+            GCC_MEMORY_BARRIER();               \
+            const uint16_t t_1 = TCNT1;         \
+            GCC_MEMORY_BARRIER();               \
+            (uint16_t)(t_1 - t_0);              \
+        })
+
+static uint16_t overhead;
+
+static void empty(void)
+{
+}
+
+/* Time one call of f, through a pointer, so that the cost of the call
+ * is the same for every benchmark, and is included in the overhead. */
+
+static uint16_t __attribute__((noinline)) measure(void (*f)(void))
+{
+    return TIME(f());
+}
+
+static void configure_endpoint_table(void)
+{
+    Endpoint_ConfigureEndpointTable(endpoints,
+                                    sizeof(endpoints) / sizeof(endpoints[0]));
+}
+
+static void usb_task(void)
+{
+    USB_USBTask();
+}
+
+static void hid_device_task(void)
+{
+    HID_Device_USBTask(&HID_Interface);
+}
+
+static void write_stream(void)
+{
+    Endpoint_Write_Stream_LE(report, sizeof(report), NULL);
+}
+
+static void write_block(void)
+{
+    Endpoint_Write_Block_LE(report, sizeof(report));
+}
+
+/* The removed bytes are stored in a volatile, so that the removal
+ * can't be optimized away. */
+
+static void ring_buffer_insert(void)
+{
+    RingBuffer_Insert(&ring_buffer, report[0]);
+}
+
+static void ring_buffer_remove(void)
+{
+    sink = RingBuffer_Remove(&ring_buffer);
+}
+
+static void spsc_ring_buffer_insert(void)
+{
+    SPSCRingBuffer_Insert(&spsc_ring_buffer, report[0]);
+}
+
+static void spsc_ring_buffer_remove(void)
+{
+    sink = SPSCRingBuffer_Remove(&spsc_ring_buffer);
+}
+
+/* Restore the state that each benchmark expects, outside the timed
+ * region.  The endpoint bank is emptied, so that writes never wait
+ * for a host to collect the data, and the HID frame number is
+ * invalidated, so that the HID task doesn't skip the call, as it
+ * would within the same frame. */
+
+static void prepare(void)
+{
+    USB_DeviceState = DEVICE_STATE_Configured;
+    HID_Interface.State.PrevFrameNum = UINT16_MAX;
+    HID_Interface.State.IdleMSRemaining = 0;
+    report[0] += 1;
+
+    Endpoint_ResetEndpoint(EPADDR);
+    Endpoint_SelectEndpoint(EPADDR);
+}
+
+static void run(const char *name, void (*f)(void))
+{
+    uint16_t minimum = UINT16_MAX, maximum = 0;
+
+    for (uint8_t i = 0; i < CALLS; i++) {
+        prepare();
+
+        const uint16_t t = measure(f) - overhead;
+
+        if (t < minimum) {
+            minimum = t;
+        }
+
+        if (t > maximum) {
+            maximum = t;
+        }
+    }
+
+    printf("BENCH %s %u %u\n", name, minimum, maximum);
+}
+
+bool CALLBACK_HID_Device_CreateHIDReport(
+    USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo,
+    uint8_t* const ReportID,
+    const uint8_t ReportType,
+    void* ReportData,
+    uint16_t* const ReportSize)
+{
+    *ReportID = REPORT_ID;
+    memcpy(ReportData, report, sizeof(report));
+    *ReportSize = sizeof(report);
+
+    return true;
+}
+
+void CALLBACK_HID_Device_ProcessHIDReport(
+    USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo,
+    const uint8_t ReportID,
+    const uint8_t ReportType,
+    const void* ReportData,
+    const uint16_t ReportSize)
+{
+}
+
+uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
+                                    const uint16_t wIndex,
+                                    const void** const DescriptorAddress)
+{
+    return NO_DESCRIPTOR;
+}
+
+static int console_putchar(char c, FILE *stream)
+{
+    GPIOR0 = c;
+    return 0;
+}
+
+static FILE console = FDEV_SETUP_STREAM(console_putchar, NULL,
+                                        _FDEV_SETUP_WRITE);
+
+int main(void)
+{
+    stdout = &console;
+
+    /* Enable the USB controller, without attaching to the bus.  The
+     * controller is clocked by the PLL, without which its registers
+     * can't be accessed, so start it first, but don't wait for it to
+     * lock for ever, in case the simulator doesn't model it. */
+
+    UHWCON = (1 << UVREGE);
+    USB_PLL_On();
+
+    for (uint16_t i = 0; i < UINT16_MAX && !USB_PLL_IsReady(); i++);
+
+    USBCON = (1 << USBE) | (1 << OTGPADE);
+
+    /* Run timer 1 at the CPU clock. */
+
+    TCCR1A = 0;
+    TCCR1B = (1 << CS10);
+
+    overhead = UINT16_MAX;
+
+    for (uint8_t i = 0; i < CALLS; i++) {
+        const uint16_t t = measure(empty);
+
+        if (t < overhead) {
+            overhead = t;
+        }
+    }
+
+    configure_endpoint_table();
+
+    run("Endpoint_ConfigureEndpointTable", configure_endpoint_table);
+    run("Endpoint_Write_Block_LE", write_block);
+    run("HID_Device_USBTask", hid_device_task);
+    run("USB_USBTask", usb_task);
+
+    /* Compare LUFA's ring buffer, which disables interrupts around
+     * each access, with the lock-free one.  Each buffer is filled
+     * first, so that the removals always find a byte. */
+
+    RingBuffer_InitBuffer(&ring_buffer, ring_buffer_data,
+                          sizeof(ring_buffer_data));
+    SPSCRingBuffer_InitBuffer(&spsc_ring_buffer, spsc_ring_buffer_data,
+                              sizeof(spsc_ring_buffer_data));
+
+    run("RingBuffer_Insert", ring_buffer_insert);
+    run("SPSCRingBuffer_Insert", spsc_ring_buffer_insert);
+    run("RingBuffer_Remove", ring_buffer_remove);
+    run("SPSCRingBuffer_Remove", spsc_ring_buffer_remove);
+
+    /* The stream functions wait for the endpoint to become ready,
+     * which depends on the simulator's USB model, so this is run
+     * last.  If it never returns, simulate.sh times the simulation
+     * out, after the other results have been printed. */
+
+    run("Endpoint_Write_Stream_LE", write_stream);
+
+    cli();
+    sleep_mode();
+
+    return 0;
+}
@@ -0,0 +1,37 @@
+# Compare two tables of benchmark results, as written by simulate.sh,
+# the first being the baseline.  Benchmarks whose minimum cycle count
+# increased, or which are missing from the second table, are listed
+# and the exit status is nonzero if there were any.
+
+FNR == 1 {
+    next
+}
+
+{
+    key = $1 "\t" $2 "\t" $3 "\t" $4 "\t" $5
+}
+
+NR == FNR {
+    baseline[key] = $6
+    next
+}
+
+{
+    seen[key] = 1
+
+    if (key in baseline && $6 + 0 > baseline[key] + 0) {
+        printf("%s: %d -> %d cycles\n", key, baseline[key], $6)
+        failed = 1
+    }
+}
+
+END {
+    for (key in baseline) {
+        if (!(key in seen)) {
+            printf("%s: missing\n", key)
+            failed = 1
+        }
+    }
+
+    exit failed
+}
@@ -0,0 +1,254 @@
+/* Main loop and report timing of the whole firmware, under simavr.
+ *
+ * This harness is linked with all of the firmware's modules.  In
+ * main.c, initialize_usb(), wait_for_host() and run_tasks() are
+ * renamed to the functions below (see the Makefile), so that the
+ * firmware initializes itself as usual, but then starts the USB
+ * controller without waiting for its PLL or for a host, and, instead
+ * of entering the scheduler, hands its task table over to this
+ * harness.
+ *
+ * A main loop iteration is timed as a run of every task in the table,
+ * as happens when they're all released in the same tick, which is the
+ * worst case.  The report build time is that of the mouse's
+ * CALLBACK_HID_Device_CreateHIDReport(), with both pointer and scroll
+ * motion pending, so that the report is split.  Motion bursts are also
+ * timed on their own, from the pointer sensor, as well as from both
+ * sensors, if a twist sensor is configured.  So is the least time spent
+ * in the USB interrupt on a control request, as well as building the
+ * feature report for GET_REPORT, in the interrupt.  All are timed with
+ * timer 3, running at the CPU clock, with interrupts disabled, and
+ * printed to the simavr console as "BENCH name min max" lines, like
+ * bench.c.
+ *
+ * The sensor driver polls for the end of each SPI transfer, so the
+ * sensor task runs as usual with interrupts disabled.  No sensor is
+ * attached to the simulated SPI bus, though, so every burst reads as
+ * a frame without motion, which is cut short after its first byte.
+ * The sensor task is therefore timed at its fastest, and the motion
+ * that's reported comes from the harness, via update_axes(). */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+#include <LUFA/Drivers/USB/USB.h>
+
+#include "avr_mcu_section.h"
+
+#include "config.h"
+#include "reports.h"
+#include "scheduler.h"
+#include "sensor.h"
+
+#ifdef ENABLE_PROFILER
+#error "The loop benchmark uses timer 3, which is also used by the profiler."
+#endif
+
+AVR_MCU(F_CPU, "atmega32u4");
+AVR_MCU_SIMAVR_CONSOLE(&GPIOR0);
+
+#define CALLS 16
+
+/* Time a statement, in cycles. */
+
+#define TIME(statement) ({                      \
+            GCC_MEMORY_BARRIER();               \
+            const uint16_t t_0 = TCNT3;         \
+            GCC_MEMORY_BARRIER();               \
+            statement;                          \
+            GCC_MEMORY_BARRIER();               \
+            const uint16_t t_1 = TCNT3;         \
+            GCC_MEMORY_BARRIER();               \
+            (uint16_t)(t_1 - t_0);              \
+        })
+
+static int console_putchar(char c, FILE *stream)
+{
+    GPIOR0 = c;
+    return 0;
+}
+
+static FILE console = FDEV_SETUP_STREAM(console_putchar, NULL,
+                                        _FDEV_SETUP_WRITE);
+
+void bench_initialize_usb(void)
+{
+    void EVENT_USB_Device_ConfigurationChanged(void);
+
+    /* Enable the USB controller, without attaching to the bus, and
+     * configure the device, as the host would.  The PLL, which clocks
+     * the controller, is started first, as in bench.c, but not waited
+     * for indefinitely.  Any output goes to the simulator's
+     * console. */
+
+    stdout = &console;
+
+    UHWCON = (1 << UVREGE);
+    USB_PLL_On();
+
+    for (uint16_t i = 0; i < UINT16_MAX && !USB_PLL_IsReady(); i++);
+
+    USBCON = (1 << USBE) | (1 << OTGPADE);
+
+    USB_DeviceState = DEVICE_STATE_Configured;
+    EVENT_USB_Device_ConfigurationChanged();
+}
+
+void bench_wait_for_host(void)
+{
+}
+
+/* The shortest and longest of the times recorded for the current
+ * benchmark. */
+
+static uint32_t minimum, maximum;
+
+static void start(void)
+{
+    minimum = UINT32_MAX;
+    maximum = 0;
+}
+
+static void record(uint32_t t)
+{
+    if (t < minimum) {
+        minimum = t;
+    }
+
+    if (t > maximum) {
+        maximum = t;
+    }
+}
+
+static void print(const char *name)
+{
+    printf("BENCH %s %lu %lu\n", name, minimum, maximum);
+}
+
+void bench_run_tasks(struct task *tasks, uint8_t n)
+{
+    void update_axes(int16_t delta_x, int16_t delta_y, bool scroll);
+    void EVENT_USB_Device_ControlRequest(void);
+    extern USB_ClassInfo_HID_Device_t HID_Interface;
+
+    cli();
+
+    TCCR3A = 0;
+    TCCR3B = (1 << CS30);
+
+    /* Time the timing itself, so that it can be subtracted. */
+
+    uint16_t overhead = UINT16_MAX;
+
+    for (uint8_t i = 0; i < CALLS; i++) {
+        const uint16_t t = TIME(GCC_MEMORY_BARRIER());
+
+        if (t < overhead) {
+            overhead = t;
+        }
+    }
+
+    /* Run every task, back to back. */
+
+    start();
+
+    for (uint8_t i = 0; i < CALLS; i++) {
+        uint32_t t = 0;
+
+        for (uint8_t j = 0; j < n; j++) {
+            t += TIME(tasks[j].run()) - overhead;
+        }
+
+        record(t);
+    }
+
+    print("main_loop");
+
+    /* Read a frame from the pointer sensor and, if there is one, from
+     * the twist sensor, back to back, as the sensor task does.  See
+     * above, for what these times do and don't include. */
+
+    start();
+
+    for (uint8_t i = 0; i < CALLS; i++) {
+        struct frame f;
+
+        record(TIME(sensor_read_frame(0, &f)) - overhead);
+    }
+
+    print("sensor_frame");
+
+#ifdef TWIST_SENSOR_SS
+    start();
+
+    for (uint8_t i = 0; i < CALLS; i++) {
+        struct frame f[2];
+
+        record(TIME(sensor_read_frame(0, &f[0]);
+                    sensor_read_frame(1, &f[1])) - overhead);
+    }
+
+    print("sensor_frame_x2");
+#endif
+
+    /* Build mouse reports, with fast pointer and scroll motion
+     * pending. */
+
+    start();
+
+    for (uint8_t i = 0; i < CALLS; i++) {
+        uint8_t report[16], id = 0;
+        uint16_t size = 0;
+
+        update_axes(INT8_MAX, -INT8_MAX, false);
+        update_axes(INT8_MAX, -INT8_MAX, true);
+
+        const uint16_t t = TIME(
+            CALLBACK_HID_Device_CreateHIDReport(
+                &HID_Interface, &id, HID_REPORT_ITEM_In, report, &size))
+            - overhead;
+
+        record(t);
+    }
+
+    print("report_build");
+
+    /* Dispatch a control request, with no SETUP packet received, so
+     * that each handler returns right away, as they do when the USB
+     * interrupt fires for anything else.  This is the least time any
+     * request spends in the interrupt. */
+
+    start();
+
+    for (uint8_t i = 0; i < CALLS; i++) {
+        Endpoint_SelectEndpoint(ENDPOINT_CONTROLEP);
+        record(TIME(EVENT_USB_Device_ControlRequest()) - overhead);
+    }
+
+    print("control_dispatch");
+
+    /* Build the feature report, as a GET_REPORT request does, in the
+     * USB interrupt.  Sending it over the control endpoint takes a
+     * host, so isn't included. */
+
+    start();
+
+    for (uint8_t i = 0; i < CALLS; i++) {
+        uint8_t report[16], id = REPORT_ID_FEATURE;
+        uint16_t size = 0;
+
+        record(TIME(CALLBACK_HID_Device_CreateHIDReport(
+                        &HID_Interface, &id, HID_REPORT_ITEM_Feature,
+                        report, &size)) - overhead);
+    }
+
+    print("feature_report");
+
+    sleep_mode();
+
+    for (;;);
+}
@@ -0,0 +1,72 @@
+#!/bin/sh
+
+# Print a tab-separated table of the builds made by "make profiles",
+# one row per combination of build options.  Each row has the section
+# sizes of the firmware build, as given by avr-size, the flash it
+# uses (text and data), whether that fits in FLASH_SIZE bytes, which
+# leaves room for the bootloader by default, and the worst-case cycle
+# counts of a main loop iteration and of building a report, from the
+# loop harness under simavr (see simulate.sh).  Counts that couldn't
+# be measured are NA.
+#
+# The build that fits, with the fastest main loop, is recommended on
+# standard error, so that standard output stays machine-readable.
+
+CROSS=${CROSS:-avr}
+FLASH_SIZE=${FLASH_SIZE:-28672}
+TAB=$(printf '\t')
+TABLE=$(mktemp)
+
+trap 'rm -f "$TABLE"' EXIT
+
+# The loop harness's results, as "profile benchmark maximum" lines.
+
+results=$(for elf in loop-O*.elf; do
+              profile=$(basename "$elf" .elf | sed 's/^loop-//')
+              ./simulate.sh "$elf" | tail -n +2 \
+                  | cut -f 5,7 | sed "s/^/$profile$TAB/"
+          done)
+
+cycles() {
+    c=$(echo "$results" | awk -F '\t' -v p="$1" -v b="$2" \
+                              '$1 == p && $2 == b {print $3}')
+    echo "${c:-NA}"
+}
+
+printf 'optimization\tlto\tlinker_relaxations\tjump_tables\ttext\tdata\tbss\tflash\tfits\tloop_cycles\treport_cycles\n' > "$TABLE"
+
+for elf in firmware-O*.elf; do
+    profile=$(basename "$elf" .elf | sed 's/^firmware-//')
+    options=$(echo "$profile" \
+              | sed -n "s/^O\(.*\)-lto\([YN]\)-relax\([YN]\)-jt\([YN]\)$/\1$TAB\2$TAB\3$TAB\4/p")
+
+    set -- $("$CROSS-size" "$elf" | tail -n 1)
+    text=$1 data=$2 bss=$3
+    flash=$((text + data))
+
+    if [ "$flash" -le "$FLASH_SIZE" ]; then
+        fits=Y
+    else
+        fits=N
+    fi
+
+    printf '%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n' "$options" "$text" "$data" "$bss" \
+           "$flash" "$fits" "$(cycles "$profile" main_loop)" \
+           "$(cycles "$profile" report_build)" >> "$TABLE"
+done
+
+cat "$TABLE"
+
+# Pick the fastest main loop, then the fastest report, then the
+# smallest build.
+
+best=$(awk -F '\t' 'NR > 1 && $9 == "Y" && $10 != "NA"' "$TABLE" \
+       | sort -t "$TAB" -k 10,10n -k 11,11n -k 8,8n | head -n 1)
+
+if [ -n "$best" ]; then
+    echo "$best" | awk -F '\t' '{
+        printf("Recommended: OPTIMIZATION=%s LTO=%s LINKER_RELAXATIONS=%s JUMP_TABLES=%s (%s cycles per loop, %s per report, %s bytes of flash)\n", $1, $2, $3, $4, $10, $11, $8)
+    }' >&2
+else
+    echo "No build that fits in flash could be measured." >&2
+fi
@@ -0,0 +1,30 @@
+#!/bin/sh
+
+# Run each of the benchmark firmwares given as arguments under simavr
+# and print a tab-separated table of the results, one row per
+# benchmark and build.  The build options are read from the file
+# names, which should be of the form <harness>-O<level>-lto<Y|N>-relax<Y|N>-jt<Y|N>.elf,
+# as produced by "make benchmarks" or "make profiles".  The cycle counts are the minimum
+# and maximum over all calls.
+#
+# A simulation that doesn't finish within TIMEOUT seconds is stopped,
+# and the benchmarks it didn't report are missing from the table.
+
+SIMAVR=${SIMAVR:-simavr}
+TIMEOUT=${TIMEOUT:-10}
+TAB=$(printf '\t')
+
+printf 'optimization\tlto\tlinker_relaxations\tjump_tables\tbenchmark\tminimum\tmaximum\n'
+
+for elf in "$@"; do
+    options=$(basename "$elf" .elf \
+              | sed -n "s/^[a-z]*-O\(.*\)-lto\([YN]\)-relax\([YN]\)-jt\([YN]\)$/\1$TAB\2$TAB\3$TAB\4/p")
+
+    if [ -z "$options" ]; then
+        echo "$elf: Unexpected file name." >&2
+        exit 1
+    fi
+
+    timeout "$TIMEOUT" "$SIMAVR" -m atmega32u4 -f 8000000 "$elf" 2>&1 \
+        | sed -n "s/.*BENCH \([A-Za-z0-9_]*\) \([0-9]*\) \([0-9]*\).*/$options$TAB\1$TAB\2$TAB\3/p"
+done
@@ -0,0 +1,54 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+
+#include "config.h"
+
+#define BUTTON_PINS ((1 << BUTTON_A) | (1 << BUTTON_B) | (1 << BUTTON_C) \
+                     | (1 << BUTTON_D) | (1 << BUTTON_E))
+
+static uint8_t old_buttons, new_buttons, debounce_count;
+
+/* Read the current button state and debounce it.  This should be
+ * called once per polling interval and returns true when the
+ * debounced state changes. */
+
+bool update_buttons(void)
+{
+    const uint8_t b = ~PIND & BUTTON_PINS;
+
+    if (!debounce_count) {
+        /* If the button state changed, start debouncing. */
+
+        if (b != old_buttons) {
+            new_buttons = b;
+            debounce_count = 1;
+        }
+    } else {
+        /* Is the new button state stable? */
+
+        if (b == new_buttons) {
+            debounce_count += 1;
+        } else {
+            debounce_count = 1;
+        }
+
+        if (debounce_count > DEBOUNCE_INTERVAL) {
+            /* Update the button state. */
+
+            old_buttons = new_buttons;
+            debounce_count = 0;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Get the debounced button state, as a mask with a bit set for each
+ * pressed button's pin. */
+
+uint8_t get_buttons(void)
+{
+    return old_buttons;
+}
@@ -5,6 +5,34 @@
 
 /* #define ENABLE_CDC */
 
+/* The interval at which sensor frames are printed to the serial
+ * console, in ms. */
+
+#define TELEMETRY_INTERVAL 100
+
+/* Uncomment this to add a vendor-defined HID interface, which streams
+ * raw sensor frames and internal counters to the host, once per ms.
+ * On Linux it can be read through hidraw, with tools/capture. */
+
+/* #define ENABLE_TELEMETRY */
+
+/* Uncomment this to enable the cycle profiler, which measures how
+ * long each stage of the main loop takes (see profile.c), as well as
+ * stack and RAM usage instrumentation (see memory.c). */
+
+/* #define ENABLE_PROFILER */
+
+/* Uncomment this to let the host restart the device into its
+ * bootloader, by writing BOOTLOADER_KEY (see reports.h) to a
+ * vendor-defined feature report of the mouse interface, so that the
+ * firmware can be updated without pressing the reset button (see
+ * tools/flash.sh).  BOOTLOADER_SIZE is the size of the boot section,
+ * in bytes, as set by the BOOTSZ fuses.  It's 4096 for the stock DFU
+ * bootloader. */
+
+/* #define ENABLE_BOOTLOADER_JUMP */
+#define BOOTLOADER_SIZE 4096
+
 /* USB device identifiers */
 
 #define MANUFACTURER L"Dimitris Papavasiliou"
@@ -12,14 +40,58 @@
 #define VENDOR_ID 0x03eb
 #define PRODUCT_ID 0x2041
 
-/* The sensor resolution, in CPI. Should be a multiple of 50. */
+/* The sensor model.  Only the PMW3389 is supported out of the box.
+ * The PMW3360 and PMW3395 can also be selected, but need files that
+ * aren't distributed with these sources, as described in pmw3360.h and
+ * pmw3395.h respectively. */
+
+#define SENSOR PMW3389
+
+/* The sensor resolution, in CPI.  Should be a multiple of 50 (or 100
+ * for the PMW3360). */
 
 #define RESOLUTION 16000
 
+/* Optionally, a list of resolution stages, in CPI, which can be cycled
+ * through by pressing all buttons in CPI_CHORD at once.  The first
+ * stage is the one used at boot, instead of RESOLUTION. */
+
+/* #define RESOLUTION_STAGES RESOLUTION, 8000, 4000 */
+/* #define CPI_CHORD BUTTON_D, BUTTON_E */
+
+/* If defined, holding this button down switches to
+ * PRECISION_RESOLUTION (for "sniper" mode). */
+
+/* #define PRECISION_BUTTON BUTTON_E */
+/* #define PRECISION_RESOLUTION 2000 */
+
+/* Motion gating.  If SQUAL_MINIMUM is defined, motion is dropped
+ * while the sensor reports lift, while the surface quality (SQUAL) is
+ * below SQUAL_MINIMUM, or, if SHUTTER_MAXIMUM is defined, while the
+ * shutter value is above it.  This suppresses spurious cursor motion
+ * when the ball is removed, for instance for cleaning.  Motion is
+ * attenuated proportionally while SQUAL is between SQUAL_MINIMUM and
+ * SQUAL_NOMINAL and remains gated for another GATE_HOLDOFF sensor
+ * frames (at most 255) after the condition clears, to allow the ball
+ * to settle.  The values below are only starting points, and should
+ * be tuned to the ball and sensor at hand. */
+
+/* #define SQUAL_MINIMUM 8 */
+/* #define SQUAL_NOMINAL 16 */
+/* #define SHUTTER_MAXIMUM 16000 */
+/* #define GATE_HOLDOFF 50 */
+
 /* The polling interval in ms. */
 
 #define POLLING_INTERVAL 2
 
+/* The interval at which the sensor is read, in us.  Should be a
+ * multiple of 250, the scheduler tick interval.  Motion is accumulated
+ * by the sensor in between reads, so this only determines how fresh
+ * the reported motion is. */
+
+#define SENSOR_INTERVAL 250
+
 /* GPIO pin numbers, where each of the five buttons and the common
  * ground are attached. */
 
@@ -34,7 +106,8 @@
 
 #define BUTTONS BUTTON_C, BUTTON_B, BUTTON_A, BUTTON_E
 
-/* Switch debounce interval, in number of polling intervals. */
+/* Switch debounce interval, in number of polling intervals.  The
+ * buttons are sampled once per polling interval. */
 
 #define DEBOUNCE_INTERVAL 5
 
@@ -44,14 +117,74 @@
 
 #define SCROLL_BUTTON BUTTON_D
 
+/* If defined, a keyboard interface is added and buttons, or chords
+ * of buttons, can be mapped to keys.  Each entry is a mask of button
+ * pins, a mask of modifiers and a key (or 0, for modifiers only),
+ * with the modifiers and keys as defined in LUFA's HIDClassCommon.h.
+ * Buttons mapped to keys don't act as mouse buttons, while the
+ * mapping is active.  Chords should be listed before the buttons
+ * they consist of.  For instance, to map buttons A and E, pressed
+ * together, to Ctrl-C and button E alone to Alt-Left (back): */
+
+/* #define KEY_MAP                                                       \
+    {(1 << BUTTON_A) | (1 << BUTTON_E),                                 \
+     HID_KEYBOARD_MODIFIER_LEFTCTRL, HID_KEYBOARD_SC_C},                \
+    {(1 << BUTTON_E),                                                   \
+     HID_KEYBOARD_MODIFIER_LEFTALT, HID_KEYBOARD_SC_LEFT_ARROW} */
+
+/* If defined, a second sensor, of the same model, is attached to the
+ * SPI bus, with its chip select on this pin of port B.  It should be
+ * mounted so that its X axis senses rotation of the ball about the
+ * vertical axis (twist), which is then reported as vertical scroll
+ * motion, scaled by TWIST_GAIN, after subtracting TWIST_COUPLING_X/Y
+ * times the pointer sensor's motion, to cancel out any
+ * cross-coupling. */
+
+/* #define TWIST_SENSOR_SS PINB4 */
+#define TWIST_GAIN 1.0
+#define TWIST_COUPLING_X 0.0
+#define TWIST_COUPLING_Y 0.0
+
 /* Scroll wheel speed coefficients. */
 
 #define WHEEL_SENSITIVITY_X 0.35
 #define WHEEL_SENSITIVITY_Y 0.35
 
+/* Uncomment this to accelerate scrolling, so that slow movements of
+ * the ball scroll precisely, while fast flings cover more ground.
+ * Each entry is the speed of the ball, in counts per polling
+ * interval, in ascending order, and the gain at that speed, in
+ * 1/256ths, by which scroll motion is multiplied, on top of the wheel
+ * speed coefficients above.  The gain is interpolated linearly
+ * between entries, and held constant beyond the first and last. */
+
+/* #define WHEEL_ACCELERATION {0, 192}, {8, 256}, {32, 640}, {96, 1536} */
+
+/* Uncomment this to emulate the detents of a physical wheel, so that
+ * scrolling is reported in whole notches, even when the host has
+ * enabled high-resolution scrolling.  Hosts that haven't always get
+ * whole notches.  The wheel clicks over to the next notch when it's
+ * WHEEL_DETENT_HYSTERESIS past the midpoint, in 1/120ths of a notch,
+ * so that it doesn't click back and forth when resting there. */
+
+/* #define WHEEL_DETENTS */
+#define WHEEL_DETENT_HYSTERESIS 20
+
 /* Pointer speed coefficient and rotation in degrees. */
 
 #define POINTER_SENSITIVITY 0.012
 #define POINTER_ROTATION -22
 
+/* Uncomment this to smooth out pointer motion over up to
+ * SMOOTHING_FRAMES polling intervals, which reduces shimmer on slow
+ * movements, due to sensor quantization noise.  The degree of
+ * smoothing drops as speed increases, from SMOOTHING_ALPHA (in
+ * 1/256ths, lower values meaning more smoothing) at rest, to none at
+ * SMOOTHING_SPEED counts per polling interval and above.  The delay
+ * added is at most SMOOTHING_FRAMES - 1 polling intervals. */
+
+/* #define SMOOTHING_FRAMES 4 */
+/* #define SMOOTHING_ALPHA 96 */
+/* #define SMOOTHING_SPEED 64 */
+
 #endif
@@ -0,0 +1,68 @@
+#include "config.h"
+
+#ifdef KEY_MAP
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+
+#include <LUFA/Drivers/USB/USB.h>
+
+struct mapping {
+    uint8_t buttons, modifiers, key;
+};
+
+static const struct mapping mappings[] PROGMEM = {KEY_MAP};
+
+static USB_KeyboardReport_Data_t keys;
+static uint8_t consumed;
+
+/* Map the debounced button state, as a mask of pins, to keys.  A
+ * mapping is active while all of its buttons are pressed, unless one
+ * of them is already taken by an active mapping earlier in the table,
+ * so that chords, if listed first, take precedence over their
+ * constituent buttons.  Buttons taken by active mappings are withheld
+ * from the mouse report. */
+
+void update_keys(uint8_t b)
+{
+    uint8_t c = 0, n = 0;
+
+    memset(&keys, 0, sizeof(keys));
+
+    for (uint8_t i = 0; i < sizeof(mappings) / sizeof(mappings[0]); i++) {
+        const uint8_t m = pgm_read_byte(&mappings[i].buttons);
+
+        if ((b & m) != m || (c & m) != 0) {
+            continue;
+        }
+
+        c |= m;
+        keys.Modifier |= pgm_read_byte(&mappings[i].modifiers);
+
+        if (n < sizeof(keys.KeyCode)) {
+            keys.KeyCode[n] = pgm_read_byte(&mappings[i].key);
+
+            if (keys.KeyCode[n]) {
+                n += 1;
+            }
+        }
+    }
+
+    consumed = c;
+}
+
+/* Get the buttons currently taken by key mappings. */
+
+uint8_t get_key_buttons(void)
+{
+    return consumed;
+}
+
+void get_keys(USB_KeyboardReport_Data_t *p)
+{
+    memcpy(p, &keys, sizeof(keys));
+}
+
+#endif
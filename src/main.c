@@ -3,159 +3,334 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <avr/power.h>
-#include <avr/sleep.h>
+#include <avr/eeprom.h>
 #include <util/delay.h>
+#include <util/atomic.h>
 
 #include "config.h"
-#include "srom.h"
-
-#define T_STDWN 0.5
-#define T_WAKEUP 50e3
-#define T_SRAD 160
-#define T_SWWR 180
-#define T_SRWR 20
-#define T_SRAD_MOTBR 35
-#define T_BEXIT 0.5
-#define T_NCS_SCLK 0.12
-#define T_SCLK_NCS_READ 0.12
-#define T_SCLK_NCS_WRITE 35
-
-#define DDRSPI DDRB
-#define PORTSPI PORTB
-#define PINSS PINB0
-#define PINSCL PINB1
-#define PINMOSI PINB2
-#define PINMISO PINB3
-
-/* Undefine the USB product id, previously defined in config.h.  We
- * don't need it here. */
-
-#undef PRODUCT_ID
-
-#define PRODUCT_ID 0x0
-#define MOTION 0x2
-#define RESOLUTION_L 0x0e
-#define RESOLUTION_H 0x0f
-#define CONFIG2 0x10
-#define ANGLE_TUNE 0x11
-#define SROM_ENABLE 0x13
-#define SROM_ID 0x2a
-#define POWER_UP_RESET 0x3a
-#define SHUTDOWN 0x3b
-#define INVERSE_PRODUCT_ID 0x3f
-#define MOTION_BURST 0x50
-#define SROM_LOAD_BURST 0x62
+#include "sensor.h"
+#include "scheduler.h"
+#include "profile.h"
+#include "memory.h"
+#include "telemetry.h"
 
 void initialize_usb(void);
 void wait_for_host(void);
 void update_axes(int16_t delta_x, int16_t delta_y, bool scroll);
+void update_twist(int16_t delta, int16_t delta_x, int16_t delta_y);
+void scale_axes(double k);
 void do_usb_tasks(void);
+bool update_buttons(void);
+uint8_t get_buttons(void);
 
-static uint8_t transceive(uint8_t c)
+#ifdef RESOLUTION_STAGES
+static const uint16_t stages[] = {RESOLUTION_STAGES};
+#else
+static const uint16_t stages[] = {RESOLUTION};
+#endif
+
+static uint16_t resolution, latency;
+static uint8_t stage;
+
+static void set_resolution(uint16_t cpi)
 {
-    SPDR = c;
+    sensor_set_resolution(cpi);
 
-    while (!(SPSR & (1 << SPIF)));
+    /* Any motion that has been accumulated, but not yet reported,
+     * was sensed at the previous resolution, so scale it to the new
+     * one, to avoid any jumps. */
 
-    return SPDR;
-}
+    if (resolution) {
+        scale_axes((double)cpi / resolution);
+    }
 
-static void assert_ncs(void)
-{
-    PORTSPI &= ~(1 << PINSS);
-}
+    /* The resolution is read by control requests, from the USB
+     * interrupt, so update it atomically. */
 
-static void deassert_ncs(void)
-{
-    PORTSPI |= (1 << PINSS);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        resolution = cpi;
+    }
 }
 
-static uint8_t read(uint8_t addr)
+/* Switch resolution as requested via the buttons.  Pressing all
+ * buttons in CPI_CHORD cycles through the resolution stages, while
+ * holding down PRECISION_BUTTON switches to PRECISION_RESOLUTION, for
+ * as long as it's held. */
+
+#if defined(CPI_CHORD) || defined(PRECISION_BUTTON)
+static void update_resolution(void)
 {
-    assert_ncs();
-    _delay_us(T_NCS_SCLK);
+    const uint8_t b = get_buttons();
+    uint16_t r = stages[stage];
+
+#ifdef CPI_CHORD
+    {
+        static bool chorded;
+        const uint8_t pins[] = {CPI_CHORD};
+        uint8_t c = 0;
+
+        for (uint8_t i = 0; i < sizeof(pins); i++) {
+            c |= (1 << pins[i]);
+        }
 
-    transceive(addr);
-    _delay_us(T_SRAD);
-    uint8_t x = transceive(0);
+        if ((b & c) == c) {
+            if (!chorded) {
+                stage = (stage + 1) % (sizeof(stages) / sizeof(stages[0]));
+                r = stages[stage];
+                chorded = true;
+            }
+        } else {
+            chorded = false;
+        }
+    }
+#endif
+
+#ifdef PRECISION_BUTTON
+    if (b & (1 << PRECISION_BUTTON)) {
+        r = PRECISION_RESOLUTION;
+    }
+#endif
 
-    _delay_us(T_SCLK_NCS_READ);
-    deassert_ncs();
-    _delay_us(T_SRWR - T_SCLK_NCS_READ);
+    if (r != resolution) {
+        /* Time the switch, with timer 1 ticking at F_CPU / 8. */
 
-    return x;
+        const uint16_t t = TCNT1;
+
+        set_resolution(r);
+
+        const uint16_t l = (uint32_t)(uint16_t)(TCNT1 - t) * 8000000 / F_CPU;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            latency = l;
+        }
+    }
 }
+#endif
+
+#ifdef SQUAL_MINIMUM
+/* Drop or attenuate motion, when the sensor can't be trusted to
+ * produce it reliably, i.e. when it reports lift, or when the surface
+ * quality or shutter indicate that the ball is missing, say because
+ * it has been removed for cleaning.  This is called for every frame,
+ * so that the holdoff counts sensor frames, whether they contain
+ * motion or not.  Only the lift bit is valid in frames without
+ * motion. */
 
-static void write(uint8_t addr, uint8_t data)
+static void gate_motion(uint8_t i, struct frame *f)
 {
-    assert_ncs();
-    _delay_us(T_NCS_SCLK);
+    static uint8_t holdoffs[SENSORS];
+    static int16_t remainders[SENSORS][2];
+    uint8_t *holdoff = &holdoffs[i];
+    int16_t *r = remainders[i];
+    const bool motion = ((f->motion & FRAME_MOTION) > 0);
+
+    if ((f->motion & FRAME_LIFT) > 0
+        || (motion && f->squal < SQUAL_MINIMUM)
+#ifdef SHUTTER_MAXIMUM
+        || (motion && f->shutter > SHUTTER_MAXIMUM)
+#endif
+        ) {
+        *holdoff = GATE_HOLDOFF;
+    } else if (*holdoff > 0) {
+        /* Keep gating for a while after things seem to have returned
+         * to normal, to let the ball settle. */
+
+        *holdoff -= 1;
+    } else {
+        /* Attenuate motion linearly, as the surface quality degrades,
+         * carrying the remainder over to the next frame, so that slow
+         * motion isn't truncated away. */
+
+        if (motion && f->squal < SQUAL_NOMINAL) {
+            const int32_t k = f->squal - SQUAL_MINIMUM;
+            const int32_t x = (int32_t)f->delta_x * k + r[0];
+            const int32_t y = (int32_t)f->delta_y * k + r[1];
+
+            f->delta_x = x / (SQUAL_NOMINAL - SQUAL_MINIMUM);
+            f->delta_y = y / (SQUAL_NOMINAL - SQUAL_MINIMUM);
+            r[0] = x % (SQUAL_NOMINAL - SQUAL_MINIMUM);
+            r[1] = y % (SQUAL_NOMINAL - SQUAL_MINIMUM);
+        }
 
-    transceive(addr | 0x80);
-    transceive(data);
+        return;
+    }
 
-    _delay_us(T_SCLK_NCS_WRITE);
-    deassert_ncs();
-    _delay_us(T_SWWR - T_SCLK_NCS_WRITE);
+    f->delta_x = 0;
+    f->delta_y = 0;
+    r[0] = r[1] = 0;
 }
+#endif
+
+/* The tasks.  The sensor is read at a fixed rate, instead of as fast
+ * as possible, so that motion is sampled uniformly and the SPI bus is
+ * left idle in between. */
+
+#ifdef ENABLE_CDC
+static struct frame last_frame;
+#endif
 
-static void reset(void)
+static void sensor_task(void)
 {
-    /* Shut down. */
+    struct frame f;
 
-    deassert_ncs();
-    _delay_us(T_SRWR);
+    sensor_read_frame(0, &f);
 
-    write(SHUTDOWN, 0xb6);
-    _delay_us(T_STDWN);
+#ifdef ENABLE_TELEMETRY
+    update_telemetry(&f);
+#endif
 
-    /* Wake up. */
+#ifdef SQUAL_MINIMUM
+    gate_motion(0, &f);
+#endif
 
-    deassert_ncs();
-    _delay_us(T_SRWR);
+#ifdef TWIST_SENSOR_SS
+    {
+        struct frame g;
 
-    write(POWER_UP_RESET, 0x5a);
-    _delay_us(T_WAKEUP);
+        sensor_read_frame(1, &g);
 
-    /* Read all motion registers. */
+#ifdef SQUAL_MINIMUM
+        gate_motion(1, &g);
+#endif
 
-    for (int i = 2; i < 7; i++) {
-        read(i);
+        /* Only frames where the twist sensor has seen motion are
+         * passed on, as the coupling correction would otherwise turn
+         * pointer motion alone into scrolling. */
+
+        if ((g.motion & FRAME_MOTION) > 0) {
+            update_twist(g.delta_x, f.delta_x, f.delta_y);
+        }
     }
+#endif
+
+#ifdef SCROLL_BUTTON
+    const bool scroll = ((PIND & (1 << SCROLL_BUTTON)) == 0);
+#else
+    const bool scroll = false;
+#endif
+
+    PROFILE_BEGIN(PROFILE_AXES);
+    update_axes(f.delta_x, f.delta_y, scroll);
+    PROFILE_END(PROFILE_AXES);
+
+#ifdef ENABLE_CDC
+    last_frame = f;
+#endif
+}
+
+static void buttons_task(void)
+{
+    update_buttons();
+
+#ifdef KEY_MAP
+    void update_keys(uint8_t b);
+
+    update_keys(get_buttons());
+#endif
 
-    /* Download SROM. */
+#if defined(CPI_CHORD) || defined(PRECISION_BUTTON)
+    update_resolution();
+#endif
+}
 
-    write(CONFIG2, 0);
-    write(SROM_ENABLE, 0x1d);
-    _delay_ms(10);
-    write(SROM_ENABLE, 0x18);
+#ifdef CPI_CHORD
+/* Save the resolution stage to the EEPROM, so that it persists across
+ * power cycles, once it has been left unchanged for a while, to avoid
+ * wearing out the EEPROM while cycling through the stages. */
 
-    assert_ncs();
-    _delay_us(T_NCS_SCLK);
+static uint8_t EEMEM saved_stage;
+
+static void persistence_task(void)
+{
+    static uint8_t last, age;
 
-    transceive(SROM_LOAD_BURST | 0x80);
+    if (stage != last) {
+        last = stage;
+        age = 0;
+    } else if (age < 5) {
+        age += 1;
 
-    for (unsigned int i = 0;
-         i < sizeof(srom_data) / sizeof(srom_data[0]);
-         i++) {
-        _delay_us(15);
-        transceive(pgm_read_byte(srom_data + i));
+        if (age == 5) {
+            eeprom_update_byte(&saved_stage, stage);
+        }
     }
+}
+#endif
 
-    _delay_us(15);
-    deassert_ncs();
+/* Let the sensors rest while the host has suspended the bus, as
+ * nothing can be reported in the meantime, to save power.  They're
+ * not shut down, so that they can still be read by the sensor task,
+ * and, as the host resumes, react as quickly as ever. */
 
-    _delay_us(200 - 15);
+static void power_task(void)
+{
+    bool host_suspended(void);
+
+    sensor_set_power(host_suspended() ? SENSOR_REST : SENSOR_RUN);
+}
+
+#ifdef ENABLE_CDC
+static void telemetry_task(void);
+#endif
+
+static struct task tasks[] = {
+    {sensor_task, SENSOR_INTERVAL / TICK_INTERVAL,
+     SENSOR_INTERVAL / TICK_INTERVAL, 0, 0},
+    {do_usb_tasks, 1, MS_TO_TICKS(1), 0, 0},
+    {buttons_task, MS_TO_TICKS(POLLING_INTERVAL),
+     MS_TO_TICKS(POLLING_INTERVAL), 0, 0},
+    {power_task, MS_TO_TICKS(100), MS_TO_TICKS(100), 0, 0},
+#ifdef CPI_CHORD
+    {persistence_task, MS_TO_TICKS(1000), MS_TO_TICKS(1000), 0, 0},
+#endif
 #ifdef ENABLE_CDC
-    const uint8_t i =
+    {telemetry_task, MS_TO_TICKS(TELEMETRY_INTERVAL),
+     MS_TO_TICKS(TELEMETRY_INTERVAL), 0, 0},
 #endif
-        read(SROM_ID);
+#ifdef ENABLE_PROFILER
+    {update_memory_usage, MS_TO_TICKS(10), MS_TO_TICKS(10), 0, 0},
+#endif
+};
 
-    write(CONFIG2, 0);
+#define TASKS (sizeof(tasks) / sizeof(tasks[0]))
 
 #ifdef ENABLE_CDC
-    printf("ID: %x, %x, %x\n", read(PRODUCT_ID), read(INVERSE_PRODUCT_ID), i);
+/* Print the last sensor frame, along with the CPU utilization, task
+ * overruns and, if the profiler is enabled, the stack high-water
+ * mark. */
+
+static void telemetry_task(void)
+{
+    const struct frame *f = &last_frame;
+
+    printf(
+        "M: %d, O: %d, X: % 5d, Y: % 5d, SQ: % 4d, R: % 3d-% 3d, SH: %5u, "
+        "U: %u%%, OV:",
+        (f->motion & FRAME_MOTION) > 0, (f->motion & FRAME_LIFT) > 0,
+        f->delta_x, f->delta_y, f->squal,
+        f->maximum_raw, f->minimum_raw, f->shutter, get_utilization());
+
+    for (uint8_t i = 0; i < TASKS; i++) {
+        printf(" %u", tasks[i].overruns);
+    }
+
+#ifdef ENABLE_PROFILER
+    {
+        struct memory_usage m;
+
+        get_memory_usage(&m);
+        printf(", ST: %u/%u", m.stack, m.stack + m.free);
+    }
 #endif
+
+    putchar('\n');
+}
+#endif
+
+void get_resolution(uint16_t *cpi, uint16_t *t)
+{
+    *cpi = resolution;
+    *t = latency;
 }
 
 int main(void)
@@ -167,12 +342,6 @@ int main(void)
     DDRD &= ~(1 << PIND0);
     PORTD |= (1 << PIND0);
 
-    /* Initialize the SPI port. */
-
-    DDRSPI |= (1 << PINMOSI) | (1 << PINSS) | (1 << PINSCL);
-    PORTSPI |= (1 << PINSS);
-    SPCR = (1 << SPE) | (1 << MSTR) | (1 << SPI2X) | (1 << CPOL) | (1 << CPHA);
-
     /* Set up the buttons. */
 
     PORTD &= ~(1 << BUTTON_GROUND);
@@ -186,81 +355,40 @@ int main(void)
         PORTD |= (1 << i);
     }
 
-    /* Reset and configure the sensor. */
+    /* Start timer 1, which is used to time things. */
 
-    reset();
+    TCCR1B = (1 << CS11);
 
-    {
-        uint16_t r = RESOLUTION / 50;
+#ifdef CPI_CHORD
+    /* Restore the saved resolution stage.  An erased EEPROM reads as
+     * 0xff, which is out of range. */
 
-        write(RESOLUTION_L, (uint8_t)(r & 0xff));
-        write(RESOLUTION_H, (uint8_t)(r >> 8 & 0xff));
+    stage = eeprom_read_byte(&saved_stage);
+
+    if (stage >= sizeof(stages) / sizeof(stages[0])) {
+        stage = 0;
     }
+#endif
+
+    /* Reset and configure the sensor. */
 
-    write(ANGLE_TUNE, POINTER_ROTATION);
+    sensor_initialize(stages[stage]);
+    resolution = stages[stage];
 
     initialize_usb();
     wait_for_host();
 
 #ifdef ENABLE_CDC
     puts("Hello world.");
-    printf("Resolution: %u\n", ((uint16_t)read(RESOLUTION_H) << 8
-                                | read(RESOLUTION_L)));
+    printf("Resolution: %u\n", resolution);
 #endif
 
-    write(MOTION_BURST, 0);
-
-    while(true) {
-#ifdef ENABLE_CDC
-#define N 12
-#else
-#define N 6
+#ifdef ENABLE_PROFILER
+    initialize_profiler();
 #endif
-        uint8_t v[N];
-
-        assert_ncs();
-        _delay_us(T_NCS_SCLK);
-
-        transceive(MOTION_BURST);
-        _delay_us(T_SRAD_MOTBR);
-
-        v[0] = transceive(0);
-
-        int delta_x, delta_y;
 
-        if ((v[0] & 0x80) > 0) {
-            for (int i = 1; i < N; i++) {
-                v[i] = transceive(0);
-            }
-
-            delta_x = *(int16_t *)(v + 2);
-            delta_y = *(int16_t *)(v + 4);
-        } else {
-            delta_x = 0;
-            delta_y = 0;
-        }
-
-        deassert_ncs();
-        /* _delay_us(T_BEXIT); */
-#undef N
-
-#ifdef SCROLL_BUTTON
-        const bool scroll = ((PIND & (1 << SCROLL_BUTTON)) == 0);
-#else
-        const bool scroll = false;
-#endif
-
-        update_axes(delta_x, delta_y, scroll);
-        do_usb_tasks();
-
-#ifdef ENABLE_CDC
-        printf(
-            "M: %d, O: %d, X: % 5d, Y: % 5d, SQ: % 4d, R: % 3d-% 3d, SH: %5u\n",
-            (v[0] & 0x80) > 0, (v[0] & 0x8) > 0,
-            delta_x, delta_y, v[6],
-            v[8], v[9], *(uint16_t *)(v + 10));
-#endif
-    }
+    initialize_scheduler();
+    run_tasks(tasks, TASKS);
 
     return 0;
 }
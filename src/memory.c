@@ -0,0 +1,103 @@
+/* RAM usage instrumentation.  All RAM between the end of the static
+ * data (.data and .bss) and the top of the stack is painted with a
+ * known pattern at boot, before main is called.  Since the stack grows
+ * downwards, the lowest address that no longer holds the pattern marks
+ * the deepest the stack has ever been.  The painted RAM is scanned for
+ * that address in the main loop, a little at a time, so that reading
+ * the usage, which can happen in the USB interrupt, is cheap. */
+
+#include "config.h"
+
+#ifdef ENABLE_PROFILER
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include <LUFA/Drivers/USB/USB.h>
+
+#include "memory.h"
+
+#define PAINT 0xc5
+
+/* The number of bytes scanned per call of update_memory_usage(). */
+
+#define SCAN_CHUNK 64
+
+extern uint8_t __data_start, __data_end, __bss_start, __bss_end;
+extern uint8_t _end, __stack;
+
+/* Paint the RAM.  This runs in .init1, before the stack pointer and
+ * the zero register have been set up, so it can't be written in C. */
+
+void paint_stack(void) __attribute__((naked, used, section(".init1")));
+
+void paint_stack(void)
+{
+    __asm__ volatile (
+        "    ldi r30, lo8(_end)\n"
+        "    ldi r31, hi8(_end)\n"
+        "    ldi r24, %0\n"
+        "    ldi r25, hi8(__stack)\n"
+        "    rjmp 2f\n"
+        "1:  st Z+, r24\n"
+        "2:  cpi r30, lo8(__stack)\n"
+        "    cpc r31, r25\n"
+        "    brlo 1b\n"
+        "    breq 1b\n"
+        :: "i" (PAINT));
+}
+
+/* The lowest address found not to hold the pattern, as of the last
+ * complete scan. */
+
+static const uint8_t *mark = &__stack;
+
+void update_memory_usage(void)
+{
+    static const uint8_t *p = &_end;
+
+    for (uint8_t i = 0; i < SCAN_CHUNK; i++, p++) {
+        if (p > &__stack || *p != PAINT) {
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                mark = p;
+            }
+
+            p = &_end;
+
+            return;
+        }
+    }
+}
+
+void get_memory_usage(struct memory_usage *m)
+{
+    const uint8_t *p;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        p = mark;
+    }
+
+    m->data = &__data_end - &__data_start;
+    m->bss = &__bss_end - &__bss_start;
+    m->stack = &__stack - p + 1;
+    m->free = p - &_end;
+}
+
+void memory_process_control_request(void)
+{
+    if (USB_ControlRequest.bRequest == MEMORY_REQUEST_READ
+        && USB_ControlRequest.bmRequestType
+        == (REQDIR_DEVICETOHOST | REQTYPE_VENDOR | REQREC_DEVICE)) {
+        struct memory_usage m;
+
+        get_memory_usage(&m);
+
+        Endpoint_ClearSETUP();
+        Endpoint_Write_Control_Stream_LE(
+            &m, MIN(USB_ControlRequest.wLength, sizeof(m)));
+        Endpoint_ClearOUT();
+    }
+}
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef _MEMORY_H_
+#define _MEMORY_H_
+
+#include <stdint.h>
+
+/* The vendor control request used to read the memory usage. */
+
+#define MEMORY_REQUEST_READ 0x52
+
+/* RAM usage, in bytes.  Stack usage is the high-water mark since
+ * boot, while free is the amount of RAM that has never been touched
+ * by the stack.  Both are as of the last complete scan of the RAM,
+ * which takes a few hundred milliseconds (see memory.c). */
+
+struct memory_usage {
+    uint16_t data, bss, stack, free;
+};
+
+#ifdef ENABLE_PROFILER
+void update_memory_usage(void);
+void get_memory_usage(struct memory_usage *m);
+void memory_process_control_request(void);
+#endif
+
+#endif
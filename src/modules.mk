@@ -0,0 +1,4 @@
+# The firmware's modules, other than $(TARGET).c.  This is shared with
+# the harness firmwares in bench/, which link the firmware in.
+
+MODULES = sensor.c usb.c axes.c buttons.c scheduler.c profile.c memory.c telemetry.c keys.c
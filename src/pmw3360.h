@@ -0,0 +1,60 @@
+/* Definitions for the PixArt PMW3360DM-T2QU.  The sensor is largely
+ * compatible with the PMW3389, but needs its own SROM image, which
+ * isn't distributed with these sources.  It should be placed in
+ * srom_pmw3360.h, as an array named srom_data, in the same format as
+ * srom_pmw3389.h. */
+
+#if __has_include("srom_pmw3360.h")
+#include "srom_pmw3360.h"
+#else
+#error "The PMW3360 needs its SROM image, in srom_pmw3360.h, as an array named srom_data, in the same format as srom_pmw3389.h."
+#endif
+
+#define T_STDWN 0.5
+#define T_WAKEUP 50e3
+#define T_SRAD 160
+#define T_SWWR 180
+#define T_SRWR 20
+#define T_SRAD_MOTBR 35
+#define T_BEXIT 0.5
+#define T_NCS_SCLK 0.12
+#define T_SCLK_NCS_READ 0.12
+#define T_SCLK_NCS_WRITE 35
+
+#define PRODUCT_ID 0x0
+#define MOTION 0x2
+#define CONFIG1 0x0f
+#define CONFIG2 0x10
+#define ANGLE_TUNE 0x11
+#define SROM_ENABLE 0x13
+#define SROM_ID 0x2a
+#define POWER_UP_RESET 0x3a
+#define SHUTDOWN 0x3b
+#define INVERSE_PRODUCT_ID 0x3f
+#define MOTION_BURST 0x50
+#define SROM_LOAD_BURST 0x62
+
+/* Bits in CONFIG2. */
+
+#define REST_EN 0x20
+
+/* Motion burst layout, following the motion register. */
+
+#define BURST_LENGTH 12
+#define BURST_DELTA_X_L 2
+#define BURST_DELTA_X_H 3
+#define BURST_DELTA_Y_L 4
+#define BURST_DELTA_Y_H 5
+#define BURST_SQUAL 6
+#define BURST_MAXIMUM_RAW 8
+#define BURST_MINIMUM_RAW 9
+#define BURST_SHUTTER_H 10
+#define BURST_SHUTTER_L 11
+
+/* The resolution is set in steps of 100 CPI, from 100 to 12000
+ * CPI. */
+
+static void write_resolution(uint16_t cpi)
+{
+    write(CONFIG1, (uint8_t)(cpi / 100 - 1));
+}
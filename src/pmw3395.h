@@ -0,0 +1,67 @@
+/* Definitions for the PixArt PAW3395DM-T6QU.  The sensor doesn't use
+ * an SROM image, but instead needs a sequence of register writes
+ * after power-up, which isn't distributed with these sources.  It
+ * should be placed in pmw3395_init.h, as an array named
+ * init_sequence, of address, value pairs, in program memory.
+ *
+ * Support for this sensor hasn't been tested on hardware yet.  The
+ * SPI timing constants are those of the PMW3389, which should be
+ * conservative.  The sensor can't rotate its axes, so pointer
+ * rotation is applied in software instead (see sensor.c). */
+
+#if __has_include("pmw3395_init.h")
+#include "pmw3395_init.h"
+#else
+#error "The PAW3395 needs its power-up register writes, in pmw3395_init.h, as an array named init_sequence, of address, value pairs, in program memory."
+#endif
+
+#define T_STDWN 0.5
+#define T_WAKEUP 50e3
+#define T_SRAD 160
+#define T_SWWR 180
+#define T_SRWR 20
+#define T_SRAD_MOTBR 35
+#define T_BEXIT 0.5
+#define T_NCS_SCLK 0.12
+#define T_SCLK_NCS_READ 0.12
+#define T_SCLK_NCS_WRITE 35
+
+#define PRODUCT_ID 0x0
+#define MOTION 0x2
+#define MOTION_BURST 0x16
+#define POWER_UP_RESET 0x3a
+#define SHUTDOWN 0x3b
+#define SET_RESOLUTION 0x47
+#define RESOLUTION_X_L 0x48
+#define RESOLUTION_X_H 0x49
+#define RESOLUTION_Y_L 0x4a
+#define RESOLUTION_Y_H 0x4b
+#define INVERSE_PRODUCT_ID 0x5f
+
+/* Motion burst layout, following the motion register. */
+
+#define BURST_LENGTH 12
+#define BURST_DELTA_X_L 2
+#define BURST_DELTA_X_H 3
+#define BURST_DELTA_Y_L 4
+#define BURST_DELTA_Y_H 5
+#define BURST_SQUAL 6
+#define BURST_MAXIMUM_RAW 8
+#define BURST_MINIMUM_RAW 9
+#define BURST_SHUTTER_H 10
+#define BURST_SHUTTER_L 11
+
+/* The resolution is set in steps of 50 CPI, from 50 to 26000 CPI,
+ * separately for each axis, and applied by writing to
+ * SET_RESOLUTION. */
+
+static void write_resolution(uint16_t cpi)
+{
+    const uint16_t r = cpi / 50;
+
+    write(RESOLUTION_X_L, (uint8_t)(r & 0xff));
+    write(RESOLUTION_X_H, (uint8_t)(r >> 8 & 0xff));
+    write(RESOLUTION_Y_L, (uint8_t)(r & 0xff));
+    write(RESOLUTION_Y_H, (uint8_t)(r >> 8 & 0xff));
+    write(SET_RESOLUTION, 0x01);
+}
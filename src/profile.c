@@ -0,0 +1,124 @@
+/* A per-stage cycle profiler.  The duration of each stage is measured
+ * in CPU cycles, with timer 3, and accumulated into a histogram, along
+ * with the total and maximum.  Durations include time spent in any
+ * interrupts that fire during the stage.
+ *
+ * The profile can be read over USB, with a vendor control request
+ * (see tools/profile.c), or, since it's kept in the global profile,
+ * from the simulator, e.g. with simavr's GDB server:
+ *
+ *     avr-gdb -ex 'target remote :1234' -ex 'print profile' Trackball.elf
+ *
+ * Since timer 3 counts cycles, the results under simulation are
+ * reproducible. */
+
+#include "config.h"
+
+#ifdef ENABLE_PROFILER
+
+#include <stdint.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include <LUFA/Drivers/USB/USB.h>
+
+#include "profile.h"
+
+uint16_t profile_starts[PROFILE_STAGES];
+struct profile profile;
+
+static uint16_t overflows;
+
+ISR(TIMER3_OVF_vect)
+{
+    overflows += 1;
+}
+
+void initialize_profiler(void)
+{
+    TCCR3A = 0;
+    TCCR3B = (1 << CS30);
+    TIMSK3 = (1 << TOIE3);
+}
+
+void profile_end(uint8_t stage)
+{
+    struct profile_stage *s = &profile.stages[stage];
+    uint16_t d = TCNT3 - profile_starts[stage];
+    uint8_t k;
+
+    s->count += 1;
+    s->total += d;
+
+    if (d > s->maximum) {
+        s->maximum = d;
+    }
+
+    d >>= 5;
+    for (k = 0; d > 0 && k < PROFILE_BUCKETS - 1; k++) {
+        d >>= 1;
+    }
+
+    if (s->histogram[k] < UINT16_MAX) {
+        s->histogram[k] += 1;
+    }
+}
+
+/* Update the elapsed time, in cycles, since the profile was last
+ * reset. */
+
+static void update_elapsed(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint16_t t = TCNT3;
+
+        /* Account for an overflow that hasn't been serviced yet. */
+
+        if ((TIFR3 & (1 << TOV3)) && t < 0x8000) {
+            overflows += 1;
+            TIFR3 = (1 << TOV3);
+        }
+
+        profile.elapsed = (uint32_t)overflows << 16 | t;
+    }
+}
+
+static void reset(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        memset(&profile, 0, sizeof(profile));
+        overflows = 0;
+        TCNT3 = 0;
+    }
+}
+
+void profile_process_control_request(void)
+{
+    switch (USB_ControlRequest.bRequest) {
+    case PROFILE_REQUEST_READ:
+        if (USB_ControlRequest.bmRequestType
+            == (REQDIR_DEVICETOHOST | REQTYPE_VENDOR | REQREC_DEVICE)) {
+            Endpoint_ClearSETUP();
+            update_elapsed();
+            Endpoint_Write_Control_Stream_LE(
+                &profile, MIN(USB_ControlRequest.wLength, sizeof(profile)));
+            Endpoint_ClearOUT();
+        }
+
+        break;
+
+    case PROFILE_REQUEST_RESET:
+        if (USB_ControlRequest.bmRequestType
+            == (REQDIR_HOSTTODEVICE | REQTYPE_VENDOR | REQREC_DEVICE)) {
+            Endpoint_ClearSETUP();
+            reset();
+            Endpoint_ClearStatusStage();
+        }
+
+        break;
+    }
+}
+
+#endif
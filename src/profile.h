@@ -0,0 +1,66 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include <stdint.h>
+
+#include "config.h"
+
+/* The profiled stages.  Stages may nest, so for instance the wait
+ * within the sensor's motion burst is also counted as part of the
+ * burst. */
+
+enum {
+    PROFILE_SENSOR = 0,         /* The motion burst (sensor_read_frame) */
+    PROFILE_SENSOR_WAIT,        /* The delay within the motion burst */
+    PROFILE_AXES,               /* update_axes */
+    PROFILE_HID,                /* HID_Device_USBTask */
+    PROFILE_USB,                /* USB_USBTask */
+    PROFILE_CDC,                /* CDC_Device_USBTask */
+    PROFILE_CONTROL,            /* Class and vendor control requests */
+    PROFILE_IDLE,               /* Sleeping, waiting for the next tick */
+    PROFILE_STAGES
+};
+
+/* Durations are binned into log2 buckets, with bucket 0 holding
+ * durations below 32 cycles, bucket 1 durations in [32, 64) and so on,
+ * with the last bucket holding anything above 32768 cycles. */
+
+#define PROFILE_BUCKETS 12
+
+/* Vendor control requests, to read and reset the profile. */
+
+#define PROFILE_REQUEST_READ 0x50
+#define PROFILE_REQUEST_RESET 0x51
+
+struct profile_stage {
+    uint32_t count, total;
+    uint16_t maximum;
+    uint16_t histogram[PROFILE_BUCKETS];
+};
+
+struct profile {
+    uint32_t elapsed;
+    struct profile_stage stages[PROFILE_STAGES];
+};
+
+#ifdef ENABLE_PROFILER
+#include <avr/io.h>
+
+extern uint16_t profile_starts[PROFILE_STAGES];
+
+void initialize_profiler(void);
+void profile_end(uint8_t stage);
+void profile_process_control_request(void);
+
+/* Mark the beginning and end of a stage.  Timer 3 runs at F_CPU, so
+ * that durations are in cycles.  When the profiler is disabled these
+ * compile to nothing. */
+
+#define PROFILE_BEGIN(stage) (profile_starts[stage] = TCNT3)
+#define PROFILE_END(stage) profile_end(stage)
+#else
+#define PROFILE_BEGIN(stage)
+#define PROFILE_END(stage)
+#endif
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef _REPORTS_H_
+#define _REPORTS_H_
+
+/* The report descriptor of the mouse interface, and the layout of its
+ * reports.  Apart from usb.c, this is also included by host-side
+ * tools, which present it to the host's HID stack, or check it, so it
+ * should depend only on config.h and LUFA's HIDReportData.h.  On the
+ * host, USB_Descriptor_HIDReport_Datatype_t, PROGMEM and ATTR_PACKED
+ * have to be defined before including it (see
+ * tools/reports_host.h). */
+
+#define MOUSE_EPSIZE 8
+
+/* Pointer motion and scrolling are sent in separate reports, as they
+ * don't normally happen at the same time, so that each fits in a
+ * single packet. */
+
+enum {
+    REPORT_ID_POINTER = 1,
+    REPORT_ID_SCROLL,
+    REPORT_ID_FEATURE,
+    REPORT_ID_BOOTLOADER
+};
+
+/* The value to write to the bootloader report, to restart into the
+ * bootloader (see ENABLE_BOOTLOADER_JUMP in config.h). */
+
+#define BOOTLOADER_KEY 0xb0
+
+#define BUTTON_COUNT sizeof((uint8_t[]){BUTTONS})
+
+/* The reports, as laid out by the descriptor below.  They're packed,
+ * which makes no difference on the device, so that they're laid out
+ * the same on the host. */
+
+typedef struct {
+    uint8_t buttons;
+    int16_t axes[2];
+} ATTR_PACKED PointerReport_Data_t;
+
+typedef struct {
+    int16_t axes[2];
+} ATTR_PACKED ScrollReport_Data_t;
+
+/* The boot protocol report, as defined in appendix B of the HID
+ * specification. */
+
+typedef struct {
+    uint8_t buttons;
+    int8_t x, y;
+} ATTR_PACKED BootReport_Data_t;
+
+typedef struct {
+    uint8_t multiplier;
+    uint16_t resolution;
+    uint16_t latency;
+} ATTR_PACKED FeatureReport_Data_t;
+
+typedef struct {
+    uint8_t key;
+} ATTR_PACKED BootloaderReport_Data_t;
+
+/* Check the structs against the layout of the descriptor below, and
+ * the input reports against the endpoint size, at compile time, so
+ * that the firmware fails to build, should they go out of sync.
+ * tools/descriptor checks the descriptor against the structs field
+ * by field, and fuzzes it (see make check). */
+
+_Static_assert(BUTTON_COUNT < 8,
+               "The buttons, and their padding, must fit in a byte.");
+_Static_assert(sizeof(PointerReport_Data_t) == 1 + 2 * 2,
+               "The pointer report is a byte of buttons and two 16-bit axes.");
+_Static_assert(sizeof(ScrollReport_Data_t) == 2 * 2,
+               "The scroll report is two 16-bit axes.");
+_Static_assert(sizeof(BootReport_Data_t) == 3,
+               "The boot protocol report is fixed by the HID specification.");
+_Static_assert(sizeof(FeatureReport_Data_t) == 1 + 2 * 2,
+               "The feature report is a byte holding the multiplier, and "
+               "two 16-bit values.");
+_Static_assert(sizeof(BootloaderReport_Data_t) == 1,
+               "The bootloader report is a single byte.");
+
+_Static_assert(sizeof(PointerReport_Data_t) + 1 <= MOUSE_EPSIZE,
+               "The pointer report, with its ID, must fit in the endpoint.");
+_Static_assert(sizeof(ScrollReport_Data_t) + 1 <= MOUSE_EPSIZE,
+               "The scroll report, with its ID, must fit in the endpoint.");
+_Static_assert(sizeof(BootReport_Data_t) <= MOUSE_EPSIZE,
+               "The boot protocol report must fit in the endpoint.");
+
+static const USB_Descriptor_HIDReport_Datatype_t PROGMEM MouseReport[] = {
+    HID_RI_USAGE_PAGE(8, 0x01), /* Generic Desktop */
+    HID_RI_USAGE(8, 0x02), /* Mouse */
+    HID_RI_COLLECTION(8, 0x01), /* Application */
+    HID_RI_USAGE(8, 0x01), /* Pointer */
+    HID_RI_COLLECTION(8, 0x00), /* Physical */
+    HID_RI_REPORT_ID(8, REPORT_ID_POINTER),
+    HID_RI_USAGE_PAGE(8, 0x09), /* Button */
+    HID_RI_USAGE_MINIMUM(8, 0x01),
+    HID_RI_USAGE_MAXIMUM(8, BUTTON_COUNT),
+    HID_RI_LOGICAL_MINIMUM(8, 0x00),
+    HID_RI_LOGICAL_MAXIMUM(8, 0x01),
+    HID_RI_REPORT_COUNT(8, BUTTON_COUNT),
+    HID_RI_REPORT_SIZE(8, 0x01),
+    HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+    HID_RI_REPORT_COUNT(8, 0x01),
+    HID_RI_REPORT_SIZE(8, 8 - (BUTTON_COUNT % 8)),
+    HID_RI_INPUT(8, HID_IOF_CONSTANT),
+
+    HID_RI_USAGE_PAGE(8, 0x01), /* Generic Desktop */
+    HID_RI_USAGE(8, 0x30), /* Usage X */
+    HID_RI_USAGE(8, 0x31), /* Usage Y */
+    HID_RI_LOGICAL_MINIMUM(16, -32768),
+    HID_RI_LOGICAL_MAXIMUM(16, 32767),
+    HID_RI_PHYSICAL_MINIMUM(8, -1),
+    HID_RI_PHYSICAL_MAXIMUM(8, 1),
+    HID_RI_REPORT_COUNT(8, 0x02),
+    HID_RI_REPORT_SIZE(8, 16),
+    HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_RELATIVE),
+
+    HID_RI_COLLECTION(8, 0x02), /* Logical */
+    HID_RI_REPORT_ID(8, REPORT_ID_FEATURE),
+    HID_RI_USAGE(8, 0x48), /* Resolution Multiplier */
+    HID_RI_LOGICAL_MINIMUM(8, 0x00),
+    HID_RI_LOGICAL_MAXIMUM(8, 0x01),
+    HID_RI_PHYSICAL_MINIMUM(8, 0x01),
+    HID_RI_PHYSICAL_MAXIMUM(8, 120),
+    HID_RI_REPORT_COUNT(8, 0x01),
+    HID_RI_REPORT_SIZE(8, 0x02),
+    HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+
+    HID_RI_REPORT_ID(8, REPORT_ID_SCROLL),
+    HID_RI_USAGE_PAGE(8, 0x0c), /* Consumer devices */
+    HID_RI_USAGE(16, 0x0238), /* AC pan */
+    HID_RI_LOGICAL_MINIMUM(16, -32768),
+    HID_RI_LOGICAL_MAXIMUM(16, 32767),
+    HID_RI_PHYSICAL_MINIMUM(8, 0),
+    HID_RI_PHYSICAL_MAXIMUM(8, 0),
+    HID_RI_REPORT_SIZE(8, 16),
+    HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_RELATIVE),
+
+    HID_RI_USAGE_PAGE(8, 0x01), /* Generic Desktop */
+    HID_RI_USAGE(8, 0x38), /* Wheel */
+    HID_RI_LOGICAL_MINIMUM(16, -32768),
+    HID_RI_LOGICAL_MAXIMUM(16, 32767),
+    HID_RI_PHYSICAL_MINIMUM(8, 0),
+    HID_RI_PHYSICAL_MAXIMUM(8, 0),
+    HID_RI_REPORT_SIZE(8, 16),
+    HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_RELATIVE),
+    HID_RI_END_COLLECTION(0),
+
+    HID_RI_REPORT_ID(8, REPORT_ID_FEATURE),
+    HID_RI_REPORT_COUNT(8, 0x01),
+    HID_RI_REPORT_SIZE(8, 0x06),
+    HID_RI_FEATURE(8, HID_IOF_CONSTANT | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+
+    HID_RI_USAGE_PAGE(16, 0xff00), /* Vendor defined */
+    HID_RI_USAGE(8, 0x01), /* Sensor resolution, in CPI */
+    HID_RI_USAGE(8, 0x02), /* Resolution switch latency, in us */
+    HID_RI_LOGICAL_MINIMUM(8, 0),
+    HID_RI_LOGICAL_MAXIMUM(32, 65535),
+    HID_RI_REPORT_COUNT(8, 0x02),
+    HID_RI_REPORT_SIZE(8, 16),
+    HID_RI_FEATURE(8, HID_IOF_CONSTANT | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+
+#ifdef ENABLE_BOOTLOADER_JUMP
+    HID_RI_REPORT_ID(8, REPORT_ID_BOOTLOADER),
+    HID_RI_USAGE(8, 0x03), /* Bootloader jump */
+    HID_RI_LOGICAL_MINIMUM(8, 0),
+    HID_RI_LOGICAL_MAXIMUM(16, 255),
+    HID_RI_REPORT_COUNT(8, 0x01),
+    HID_RI_REPORT_SIZE(8, 8),
+    HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+#endif
+
+    HID_RI_END_COLLECTION(0),
+    HID_RI_END_COLLECTION(0)
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+#include "config.h"
+#include "scheduler.h"
+#include "profile.h"
+
+/* The window over which CPU utilization is measured, in ticks. */
+
+#define WINDOW MS_TO_TICKS(1000)
+
+static volatile uint16_t ticks;
+static uint32_t busy;
+static uint8_t utilization;
+static uint16_t overruns;
+
+ISR(TIMER0_COMPA_vect)
+{
+    ticks += 1;
+}
+
+/* Start the tick, using timer 0 in CTC mode, at F_CPU / 8. */
+
+void initialize_scheduler(void)
+{
+    TCCR0A = (1 << WGM01);
+    TCCR0B = (1 << CS01);
+    OCR0A = (uint8_t)((uint32_t)F_CPU / 8 * TICK_INTERVAL / 1000000 - 1);
+    TIMSK0 = (1 << OCIE0A);
+}
+
+uint16_t get_ticks(void)
+{
+    uint16_t t;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        t = ticks;
+    }
+
+    return t;
+}
+
+/* The percentage of time spent running tasks, during the last
+ * measurement window. */
+
+uint8_t get_utilization(void)
+{
+    return utilization;
+}
+
+/* The total number of overruns, across all tasks. */
+
+uint16_t get_overruns(void)
+{
+    return overruns;
+}
+
+/* Run the tasks forever.  Tasks are run to completion, in order of
+ * priority, which is their order in the table, whenever they're
+ * released.  When no task is ready to run, the CPU sleeps until the
+ * next interrupt.  Task execution time is measured with timer 1,
+ * which is assumed to be running at F_CPU / 8. */
+
+void run_tasks(struct task *tasks, uint8_t n)
+{
+    uint16_t window = get_ticks();
+
+    for (uint8_t i = 0; i < n; i++) {
+        tasks[i].release = window;
+    }
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
+
+    while (true) {
+        bool idle = true;
+
+        for (uint8_t i = 0; i < n; i++) {
+            struct task *t = &tasks[i];
+
+            if ((int16_t)(get_ticks() - t->release) < 0) {
+                continue;
+            }
+
+            const uint16_t t_0 = TCNT1;
+
+            t->run();
+
+            busy += (uint16_t)(TCNT1 - t_0);
+
+            const uint16_t now = get_ticks();
+
+            if ((uint16_t)(now - t->release) >= t->deadline) {
+                t->overruns += 1;
+                overruns += 1;
+            }
+
+            /* Schedule the next release.  If we've fallen behind by
+             * more than a period, skip the releases we've missed,
+             * instead of trying to catch up. */
+
+            t->release += t->period;
+
+            if ((int16_t)(now - t->release) > 0) {
+                t->release = now;
+            }
+
+            idle = false;
+
+            /* Give higher priority tasks a chance to run. */
+
+            break;
+        }
+
+        /* Update the utilization estimate. */
+
+        {
+            const uint16_t now = get_ticks();
+
+            if ((uint16_t)(now - window) >= WINDOW) {
+                /* Convert the busy time to microseconds first, so as not
+                 * to overflow.  It's at most a window's worth, i.e. 10^6
+                 * microseconds. */
+
+                const uint32_t t = busy * 8 / (F_CPU / 1000000);
+
+                utilization = (
+                    t * 100
+                    / ((uint32_t)(uint16_t)(now - window) * TICK_INTERVAL));
+
+                busy = 0;
+                window = now;
+            }
+        }
+
+        if (idle) {
+            PROFILE_BEGIN(PROFILE_IDLE);
+            sleep_mode();
+            PROFILE_END(PROFILE_IDLE);
+        }
+    }
+}
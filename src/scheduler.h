@@ -0,0 +1,29 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <stdint.h>
+
+/* The scheduler tick interval, in us, and a macro to convert
+ * milliseconds to ticks. */
+
+#define TICK_INTERVAL 250
+#define MS_TO_TICKS(t) ((uint16_t)((t) * 1000UL / TICK_INTERVAL))
+
+/* A periodic task.  The task is released every period ticks and
+ * should have run to completion within deadline ticks of its release.
+ * Each time it doesn't, it's counted as an overrun. */
+
+struct task {
+    void (*run)(void);
+    uint16_t period, deadline;
+
+    uint16_t release, overruns;
+};
+
+void initialize_scheduler(void);
+void run_tasks(struct task *tasks, uint8_t n) __attribute__((noreturn));
+uint16_t get_ticks(void);
+uint8_t get_utilization(void);
+uint16_t get_overruns(void);
+
+#endif
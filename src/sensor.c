@@ -0,0 +1,378 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <util/delay.h>
+
+#include "config.h"
+#include "sensor.h"
+#include "profile.h"
+
+#define DDRSPI DDRB
+#define PORTSPI PORTB
+#define PINSS PINB0
+#define PINSCL PINB1
+#define PINMOSI PINB2
+#define PINMISO PINB3
+
+/* Undefine the USB product id, previously defined in config.h.  We
+ * don't need it here. */
+
+#undef PRODUCT_ID
+
+/* The chip select of each sensor, as a mask on port B. */
+
+static const uint8_t chip_selects[SENSORS] = {
+    (1 << PINSS),
+#ifdef TWIST_SENSOR_SS
+    (1 << TWIST_SENSOR_SS),
+#endif
+};
+
+static uint8_t ss = (1 << PINSS);
+
+static uint8_t read(uint8_t addr);
+static void write(uint8_t addr, uint8_t data);
+
+/* Pull in the definitions for the selected sensor.  These are
+ * resolved at compile time, so that there's no cost to supporting
+ * more than one sensor. */
+
+#if SENSOR == PMW3360
+#include "pmw3360.h"
+#elif SENSOR == PMW3389
+#include "pmw3389.h"
+#elif SENSOR == PMW3395
+#include "pmw3395.h"
+#else
+#error "Unsupported sensor."
+#endif
+
+/* Read the whole motion burst only if we're going to use all of
+ * it. */
+
+#if defined(ENABLE_CDC) || defined(ENABLE_TELEMETRY) || defined(SQUAL_MINIMUM)
+#define N BURST_LENGTH
+#else
+#define N (BURST_DELTA_Y_H + 1)
+#endif
+
+static uint8_t transceive(uint8_t c)
+{
+    SPDR = c;
+
+    while (!(SPSR & (1 << SPIF)));
+
+    return SPDR;
+}
+
+/* Select sensor i, for subsequent operations. */
+
+static void select(uint8_t i)
+{
+    ss = chip_selects[i];
+}
+
+static void assert_ncs(void)
+{
+    PORTSPI &= ~ss;
+}
+
+static void deassert_ncs(void)
+{
+    PORTSPI |= ss;
+}
+
+static uint8_t read(uint8_t addr)
+{
+    assert_ncs();
+    _delay_us(T_NCS_SCLK);
+
+    transceive(addr);
+    _delay_us(T_SRAD);
+    uint8_t x = transceive(0);
+
+    _delay_us(T_SCLK_NCS_READ);
+    deassert_ncs();
+    _delay_us(T_SRWR - T_SCLK_NCS_READ);
+
+    return x;
+}
+
+static void write(uint8_t addr, uint8_t data)
+{
+    assert_ncs();
+    _delay_us(T_NCS_SCLK);
+
+    transceive(addr | 0x80);
+    transceive(data);
+
+    _delay_us(T_SCLK_NCS_WRITE);
+    deassert_ncs();
+    _delay_us(T_SWWR - T_SCLK_NCS_WRITE);
+}
+
+static void reset(void)
+{
+    /* Shut down. */
+
+    deassert_ncs();
+    _delay_us(T_SRWR);
+
+    write(SHUTDOWN, 0xb6);
+    _delay_us(T_STDWN);
+
+    /* Wake up. */
+
+    deassert_ncs();
+    _delay_us(T_SRWR);
+
+    write(POWER_UP_RESET, 0x5a);
+    _delay_us(T_WAKEUP);
+
+    /* Read all motion registers. */
+
+    for (int i = 2; i < 7; i++) {
+        read(i);
+    }
+
+#ifdef SROM_LOAD_BURST
+    /* Download SROM. */
+
+    write(CONFIG2, 0);
+    write(SROM_ENABLE, 0x1d);
+    _delay_ms(10);
+    write(SROM_ENABLE, 0x18);
+
+    assert_ncs();
+    _delay_us(T_NCS_SCLK);
+
+    transceive(SROM_LOAD_BURST | 0x80);
+
+    for (unsigned int i = 0;
+         i < sizeof(srom_data) / sizeof(srom_data[0]);
+         i++) {
+        _delay_us(15);
+        transceive(pgm_read_byte(srom_data + i));
+    }
+
+    _delay_us(15);
+    deassert_ncs();
+
+    _delay_us(200 - 15);
+#ifdef ENABLE_CDC
+    const uint8_t i =
+#endif
+        read(SROM_ID);
+
+    write(CONFIG2, 0);
+#else
+    /* Carry out the initialization sequence. */
+
+#ifdef ENABLE_CDC
+    const uint8_t i = 0;
+#endif
+
+    for (unsigned int j = 0;
+         j < sizeof(init_sequence) / sizeof(init_sequence[0]);
+         j++) {
+        write(pgm_read_byte(&init_sequence[j][0]),
+              pgm_read_byte(&init_sequence[j][1]));
+    }
+#endif
+
+#ifdef ENABLE_CDC
+    printf("ID: %x, %x, %x\n", read(PRODUCT_ID), read(INVERSE_PRODUCT_ID), i);
+#endif
+}
+
+#if !defined(ANGLE_TUNE) && POINTER_ROTATION != 0
+/* Rotate the pointer sensor's axes clockwise by POINTER_ROTATION
+ * degrees, as the ANGLE_TUNE register of the sensors that have one
+ * does, for sensors that don't.  The rotation is carried out in fixed
+ * point, with 14 fractional bits, and the fractions of a count left
+ * over are carried over to the next frame, so that slow motion isn't
+ * lost. */
+
+#define SOFTWARE_ROTATION
+
+static void rotate(struct frame *f)
+{
+    const int32_t c = round(cos(POINTER_ROTATION * M_PI / 180) * 16384);
+    const int32_t s = round(sin(POINTER_ROTATION * M_PI / 180) * 16384);
+    static int32_t r[2];
+
+    const int32_t x = f->delta_x * c - f->delta_y * s + r[0];
+    const int32_t y = f->delta_x * s + f->delta_y * c + r[1];
+
+    f->delta_x = x / 16384;
+    f->delta_y = y / 16384;
+    r[0] = x % 16384;
+    r[1] = y % 16384;
+}
+#endif
+
+static uint16_t resolution;
+
+static void configure(uint8_t i)
+{
+    write_resolution(resolution);
+
+#ifdef ANGLE_TUNE
+    /* Rotation only applies to the pointer sensor. */
+
+    write(ANGLE_TUNE, i == 0 ? POINTER_ROTATION : 0);
+#endif
+
+    write(MOTION_BURST, 0);
+}
+
+void sensor_initialize(uint16_t cpi)
+{
+    /* Initialize the SPI port. */
+
+    DDRSPI |= (1 << PINMOSI) | (1 << PINSS) | (1 << PINSCL);
+    PORTSPI |= (1 << PINSS);
+    SPCR = (1 << SPE) | (1 << MSTR) | (1 << SPI2X) | (1 << CPOL) | (1 << CPHA);
+
+#ifdef TWIST_SENSOR_SS
+    DDRSPI |= (1 << TWIST_SENSOR_SS);
+    PORTSPI |= (1 << TWIST_SENSOR_SS);
+#endif
+
+    /* Reset and configure the sensors. */
+
+    resolution = cpi;
+
+    for (uint8_t i = 0; i < SENSORS; i++) {
+        select(i);
+        reset();
+        configure(i);
+    }
+}
+
+/* Change the resolution, without resetting the sensor.  Writing any
+ * other register takes the sensor out of motion burst mode, so it's
+ * rearmed afterwards, as in configure(). */
+
+void sensor_set_resolution(uint16_t cpi)
+{
+    for (uint8_t i = 0; i < SENSORS; i++) {
+        select(i);
+        write_resolution(cpi);
+        write(MOTION_BURST, 0);
+    }
+
+    resolution = cpi;
+}
+
+void sensor_set_power(uint8_t mode)
+{
+    static uint8_t current;
+
+    if (mode == current) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < SENSORS; i++) {
+        select(i);
+
+        /* Coming out of shutdown requires a full reset. */
+
+        if (current == SENSOR_SHUTDOWN) {
+            reset();
+            configure(i);
+        }
+
+        switch (mode) {
+#ifdef REST_EN
+        case SENSOR_RUN:
+            write(CONFIG2, 0);
+            break;
+
+        case SENSOR_REST:
+            write(CONFIG2, REST_EN);
+            break;
+#endif
+
+        case SENSOR_SHUTDOWN:
+            write(SHUTDOWN, 0xb6);
+            break;
+        }
+
+        /* Rearm motion burst mode, which the writes above, as well as
+         * configure(), when coming out of shutdown, leave disarmed. */
+
+        if (mode != SENSOR_SHUTDOWN) {
+            write(MOTION_BURST, 0);
+        }
+    }
+
+    current = mode;
+}
+
+/* Read a frame from sensor i.  Bursts from more than one sensor can't
+ * overlap, as they share the SPI bus, so the sensors should be read
+ * back to back. */
+
+void sensor_read_frame(uint8_t i, struct frame *f)
+{
+    uint8_t v[N];
+
+    PROFILE_BEGIN(PROFILE_SENSOR);
+
+    select(i);
+
+    assert_ncs();
+    _delay_us(T_NCS_SCLK);
+
+    transceive(MOTION_BURST);
+
+    PROFILE_BEGIN(PROFILE_SENSOR_WAIT);
+    _delay_us(T_SRAD_MOTBR);
+    PROFILE_END(PROFILE_SENSOR_WAIT);
+
+    v[0] = transceive(0);
+    f->motion = v[0];
+
+    if ((v[0] & FRAME_MOTION) > 0) {
+        for (uint8_t j = 1; j < N; j++) {
+            v[j] = transceive(0);
+        }
+
+        f->delta_x = (int16_t)((uint16_t)v[BURST_DELTA_X_H] << 8
+                               | v[BURST_DELTA_X_L]);
+        f->delta_y = (int16_t)((uint16_t)v[BURST_DELTA_Y_H] << 8
+                               | v[BURST_DELTA_Y_L]);
+
+#if N > BURST_DELTA_Y_H + 1
+        f->squal = v[BURST_SQUAL];
+        f->maximum_raw = v[BURST_MAXIMUM_RAW];
+        f->minimum_raw = v[BURST_MINIMUM_RAW];
+        f->shutter = ((uint16_t)v[BURST_SHUTTER_H] << 8
+                      | v[BURST_SHUTTER_L]);
+#endif
+    } else {
+        f->delta_x = 0;
+        f->delta_y = 0;
+
+#if N > BURST_DELTA_Y_H + 1
+        f->squal = 0;
+        f->maximum_raw = 0;
+        f->minimum_raw = 0;
+        f->shutter = 0;
+#endif
+    }
+
+    deassert_ncs();
+    /* _delay_us(T_BEXIT); */
+
+#ifdef SOFTWARE_ROTATION
+    if (i == 0 && (f->motion & FRAME_MOTION) > 0) {
+        rotate(f);
+    }
+#endif
+
+    PROFILE_END(PROFILE_SENSOR);
+}
@@ -0,0 +1,52 @@
+#ifndef _SENSOR_H_
+#define _SENSOR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config.h"
+
+/* Supported sensors, to be selected with SENSOR in config.h. */
+
+#define PMW3360 3360
+#define PMW3389 3389
+#define PMW3395 3395
+
+/* The number of attached sensors.  The first one senses pointer
+ * motion, the optional second one twist. */
+
+#ifdef TWIST_SENSOR_SS
+#define SENSORS 2
+#else
+#define SENSORS 1
+#endif
+
+/* Bits in the motion byte of a frame. */
+
+#define FRAME_MOTION 0x80
+#define FRAME_LIFT 0x08
+
+/* Power modes. */
+
+enum {
+    SENSOR_RUN,
+    SENSOR_REST,
+    SENSOR_SHUTDOWN
+};
+
+/* A sensor frame, as read via a motion burst.  All fields except
+ * motion are only valid if FRAME_MOTION is set. */
+
+struct frame {
+    uint8_t motion;
+    int16_t delta_x, delta_y;
+    uint8_t squal, maximum_raw, minimum_raw;
+    uint16_t shutter;
+};
+
+void sensor_initialize(uint16_t cpi);
+void sensor_set_resolution(uint16_t cpi);
+void sensor_set_power(uint8_t mode);
+void sensor_read_frame(uint8_t i, struct frame *f);
+
+#endif
@@ -0,0 +1,72 @@
+#include "config.h"
+
+#ifdef ENABLE_TELEMETRY
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "sensor.h"
+#include "scheduler.h"
+#include "telemetry.h"
+
+static struct telemetry current;
+
+static int16_t saturate(int32_t x)
+{
+    if (x > INT16_MAX) {
+        return INT16_MAX;
+    } else if (x < INT16_MIN) {
+        return INT16_MIN;
+    }
+
+    return x;
+}
+
+/* Accumulate a sensor frame into the current report. */
+
+void update_telemetry(const struct frame *f)
+{
+    struct telemetry *t = &current;
+
+    if (t->frames < UINT8_MAX) {
+        t->frames += 1;
+    }
+
+    t->motion |= f->motion;
+    t->delta_x = saturate((int32_t)t->delta_x + f->delta_x);
+    t->delta_y = saturate((int32_t)t->delta_y + f->delta_y);
+
+    t->squal = f->squal;
+    t->maximum_raw = f->maximum_raw;
+    t->minimum_raw = f->minimum_raw;
+    t->shutter = f->shutter;
+}
+
+/* Complete the current report, copy it to t and start a new one.
+ * Returns true if any sensor frames have been read since the last
+ * report. */
+
+bool get_telemetry(struct telemetry *t)
+{
+    void get_resolution(uint16_t *cpi, uint16_t *latency);
+    uint8_t get_buttons(void);
+    uint16_t latency;
+
+    get_resolution(&current.resolution, &latency);
+    current.buttons = get_buttons();
+    current.utilization = get_utilization();
+    current.overruns = get_overruns();
+
+    memcpy(t, &current, sizeof(current));
+
+    current.sequence += 1;
+    current.frames = 0;
+    current.motion = 0;
+    current.delta_x = 0;
+    current.delta_y = 0;
+
+    return t->frames > 0;
+}
+
+#endif
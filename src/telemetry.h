@@ -0,0 +1,31 @@
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* A telemetry report, as sent over the telemetry interface, once per
+ * USB frame.  The sensor fields describe all frames read since the
+ * previous report: the deltas are summed (and saturated), the motion
+ * bytes are OR-ed together and the rest are those of the last frame.
+ * The deltas are raw, i.e. before gating, smoothing or scaling.  All
+ * fields are little-endian. */
+
+struct telemetry {
+    uint16_t sequence;
+    uint8_t frames, motion;
+    int16_t delta_x, delta_y;
+    uint8_t squal, maximum_raw, minimum_raw, buttons;
+    uint16_t shutter, resolution;
+    uint8_t utilization, reserved;
+    uint16_t overruns;
+} __attribute__((packed));
+
+#ifdef ENABLE_TELEMETRY
+#include "sensor.h"
+
+void update_telemetry(const struct frame *f);
+bool get_telemetry(struct telemetry *t);
+#endif
+
+#endif
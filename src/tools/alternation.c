@@ -0,0 +1,148 @@
+/* Check that no motion is lost or duplicated when the pointer and
+ * scroll reports alternate.
+ *
+ * Only one report can be sent per polling interval, so when both
+ * pointer and scroll motion are pending, which happens when the
+ * scroll button is toggled in between polls, usb.c sends one of them,
+ * alternating between the two, and axes.c keeps the motion of the
+ * other, to be reported next time (see split_axes()).  This tool links
+ * a build of axes.c (see report_config.h) and drives it the same way:
+ * pseudo-random motion is fed in, one sensor frame at a time, while
+ * scrolling is toggled on and off at random intervals, and each
+ * polling interval a report is chosen with split_axes(), as in
+ * CALLBACK_HID_Device_CreateHIDReport().  Once the motion stops and
+ * all of it has been reported, the total reported on each axis is
+ * checked against the total fed in, scaled by the axis' sensitivity,
+ * with the resolution multiplier both enabled and disabled.
+ *
+ * Usage: alternation
+ *
+ * The exit status is non-zero if any check fails. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "config.h"
+#include "check.h"
+
+#define NOTCH 120
+#define POLLS 100000
+#define FRAMES_PER_POLL (POLLING_INTERVAL * 1000 / SENSOR_INTERVAL)
+
+void report_update_axes(int16_t delta_x, int16_t delta_y, bool scroll);
+bool report_get_axes(int16_t *p, int16_t limit);
+bool report_split_axes(int16_t *p, bool pointer, bool scroll);
+void report_set_wheel_multiplier(uint8_t m);
+
+static const double sensitivities[4] = {
+    POINTER_SENSITIVITY, -POINTER_SENSITIVITY,
+    WHEEL_SENSITIVITY_X, WHEEL_SENSITIVITY_Y
+};
+
+static const char *axis_names[4] = {
+    "Pointer X", "Pointer Y", "Horizontal scroll", "Vertical scroll"
+};
+
+static long fed[4], reported[4];
+static int alternations;
+
+/* Create and "send" a report, as the HID class driver would, each
+ * polling interval.  Only motion is considered; the buttons and idle
+ * reports don't affect what motion is reported. */
+
+static bool poll(void)
+{
+    int16_t a[4];
+
+    report_get_axes(a, INT16_MAX);
+
+    const bool pointer = (a[0] || a[1]);
+    const bool scroll = (a[2] || a[3]);
+
+    alternations += (pointer && scroll);
+
+    const int j = report_split_axes(a, pointer, scroll) ? 2 : 0;
+
+    reported[j] += a[j];
+    reported[j + 1] += a[j + 1];
+
+    return pointer || scroll;
+}
+
+static bool run(uint8_t multiplier)
+{
+    char name[64];
+    bool ok = true;
+    bool scroll = false;
+    uint32_t t = 0;
+
+    for (int i = 0; i < 4; i++) {
+        fed[i] = reported[i] = 0;
+    }
+
+    alternations = 0;
+    report_set_wheel_multiplier(multiplier);
+
+    for (uint32_t i = 0; i < POLLS; i++) {
+        for (uint32_t j = 0; j < FRAMES_PER_POLL; j++, t++) {
+            /* Toggle scrolling every few frames, up to a few polling
+             * intervals apart, so that it often happens in between
+             * polls. */
+
+            if (noise(t, 0, 3 * FRAMES_PER_POLL) == 0) {
+                scroll = !scroll;
+            }
+
+            const int16_t dx = (int16_t)noise(t, 1, 401) - 200;
+            const int16_t dy = (int16_t)noise(t, 2, 401) - 200;
+
+            report_update_axes(dx, dy, scroll);
+            fed[scroll * 2] += dx;
+            fed[scroll * 2 + 1] += dy;
+        }
+
+        poll();
+    }
+
+    /* Report whatever is still pending, until there's nothing left
+     * but fractions of a count, or notch. */
+
+    while (poll());
+
+    for (int i = 0; i < 4; i++) {
+        const double k = (i >= 2 && !multiplier ? 1.0 / NOTCH : 1);
+
+        snprintf(name, sizeof(name), "%s, multiplier %u", axis_names[i],
+                 multiplier);
+        ok &= check(name, reported[i], lround(fed[i] * sensitivities[i] * k),
+                    1);
+    }
+
+    snprintf(name, sizeof(name), "Alternations, multiplier %u", multiplier);
+    ok &= check(name, alternations > 0, 1, 0);
+
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    bool ok = true;
+
+    check_header();
+
+    /* Run with the multiplier enabled first, as whatever is left
+     * short of a notch without it, is reported once it's enabled. */
+
+    ok &= run(1);
+    ok &= run(0);
+
+    if (!ok) {
+        fprintf(stderr, "Some checks failed.\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,23 @@
+/* Configuration overrides for host builds of axes.c.  This header is
+ * force-included ahead of axes.c, so that config.h is read through
+ * it and later inclusions are no-ops. */
+
+#include "config.h"
+
+/* Report pointer motion in sensor counts, so that the effect of the
+ * smoothing filter can be measured, without the quantization of the
+ * (much coarser) output getting in the way. */
+
+#undef POINTER_SENSITIVITY
+#define POINTER_SENSITIVITY 1
+
+/* Use the configured smoothing parameters, or some reasonable
+ * defaults, if smoothing isn't enabled. */
+
+#ifdef UNSMOOTHED
+#undef SMOOTHING_FRAMES
+#elif !defined(SMOOTHING_FRAMES)
+#define SMOOTHING_FRAMES 4
+#define SMOOTHING_ALPHA 96
+#define SMOOTHING_SPEED 64
+#endif
@@ -0,0 +1,656 @@
+/* Offline tuning of the pointer ballistics, on the host.
+ *
+ * Usage: ballistics [OPTIONS] [FILE...]
+ *
+ * Recorded motion is replayed through the firmware's axes code, once
+ * for each point of a grid of candidate configurations, and the
+ * resulting cursor motion is measured.  FILE should contain one
+ * "dx dy" pair of sensor counts per line, one line per polling
+ * interval, as for the smoothing tool.  Several files are replayed
+ * back to back, separated by a pause.  Without any, the standard
+ * input is read.
+ *
+ * Each of the following options takes a comma-separated list of
+ * values, or a range, given as FIRST:LAST:STEP, and the grid spans
+ * all combinations of them.  The defaults are those of config.h.
+ *
+ *   -c CPI          Sensor resolution.
+ *   -s SENSITIVITY  POINTER_SENSITIVITY.
+ *   -a DEGREES      POINTER_ROTATION.
+ *   -g GAIN         Acceleration, as the rise in gain per inch/s.
+ *   -t SPEED        Speed where acceleration sets in, in inches/s.
+ *   -m GAIN         Maximum gain, or 0 (the default) for none.
+ *   -f FRAMES       SMOOTHING_FRAMES.
+ *   -l ALPHA        SMOOTHING_ALPHA, with 256 disabling smoothing.
+ *   -v SPEED        SMOOTHING_SPEED.
+ *
+ * The firmware has no pointer acceleration, so the curve, a linear
+ * rise in gain above a threshold speed, up to a maximum, is applied
+ * here, after the axes code, so that candidate curves can be tried
+ * out before they're implemented.  Only the frame counts axes.c was
+ * compiled with (see the Makefile) are available.  If smoothing isn't
+ * configured, it is disabled by default.
+ *
+ * The recording itself is described by the following options:
+ *
+ *   -C CPI          The resolution it was made at (RESOLUTION).
+ *   -A DEGREES      The rotation it was made with (POINTER_ROTATION).
+ *   -r RATE         The polling rate, in Hz (per POLLING_INTERVAL).
+ *
+ * The motion is rotated by the difference between the candidate and
+ * recorded rotations, and rescaled to the candidate resolution, with
+ * fractions of a count carried over, as the sensor would.
+ *
+ * Grid points are simulated in parallel, by JOBS processes, given
+ * with -j (one per CPU by default).  With -o DIR, the cursor path of
+ * grid point N is written to DIR/N.path, as "x y" pairs of report
+ * units, one per polling interval, followed by the ideal path (the
+ * input, scaled by the same gain, but neither smoothed nor
+ * quantized), and the effective gain, per inch/s of ball speed, to
+ * DIR/N.gain, for plotting.
+ *
+ * One line is printed per grid point, with its number and parameters,
+ * followed by:
+ *
+ * - The mean effective gain, in report units per inch of ball
+ *   motion, measured along the direction of the motion.
+ *
+ * - The jitter (the RMS change in velocity between successive
+ *   frames) and the number of direction reversals, as measured by
+ *   the smoothing tool, but in report units.
+ *
+ * - The mean lag of the cursor behind the ideal path, in frames.
+ *
+ * - The mean overshoot, in report units, i.e. how far the cursor
+ *   goes past the point where it comes to rest, along the direction
+ *   of the movement.  Movements are separated by pauses of at least
+ *   PAUSE milliseconds. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "config.h"
+
+#define MAX_VALUES 256
+#define BINS 64
+#define PAUSE 100
+
+#ifdef SMOOTHING_FRAMES
+#define DEFAULT_FRAMES SMOOTHING_FRAMES
+#define DEFAULT_ALPHA SMOOTHING_ALPHA
+#define DEFAULT_SPEED SMOOTHING_SPEED
+#else
+#define DEFAULT_FRAMES 4
+#define DEFAULT_ALPHA 256
+#define DEFAULT_SPEED 64
+#endif
+
+/* The builds of axes.c, one per number of smoothing frames, listed
+ * in VARIANTS by the Makefile. */
+
+#define V(n)                                                            \
+    void f##n##_update_axes(int16_t delta_x, int16_t delta_y, bool scroll); \
+    bool f##n##_get_axes(int16_t *p, int16_t limit);
+
+VARIANTS
+
+#undef V
+
+static const struct variant {
+    int frames;
+    void (*update)(int16_t, int16_t, bool);
+    bool (*get)(int16_t *, int16_t);
+} variants[] = {
+#define V(n) {n, f##n##_update_axes, f##n##_get_axes},
+    VARIANTS
+#undef V
+};
+
+int32_t smoothing_alpha, smoothing_speed;
+
+enum {
+    CPI,
+    SENSITIVITY,
+    ROTATION,
+    ACCELERATION,
+    THRESHOLD,
+    MAXIMUM,
+    FRAMES,
+    ALPHA,
+    SPEED,
+    PARAMETERS
+};
+
+static struct parameter {
+    const char *name;
+    char option;
+    int n;
+    double values[MAX_VALUES];
+} parameters[PARAMETERS] = {
+    [CPI] = {"cpi", 'c', 1, {RESOLUTION}},
+    [SENSITIVITY] = {"sensitivity", 's', 1, {POINTER_SENSITIVITY}},
+    [ROTATION] = {"rotation", 'a', 1, {POINTER_ROTATION}},
+    [ACCELERATION] = {"accel", 'g', 1, {0}},
+    [THRESHOLD] = {"threshold", 't', 1, {0}},
+    [MAXIMUM] = {"maximum", 'm', 1, {0}},
+    [FRAMES] = {"frames", 'f', 1, {DEFAULT_FRAMES}},
+    [ALPHA] = {"alpha", 'l', 1, {DEFAULT_ALPHA}},
+    [SPEED] = {"speed", 'v', 1, {DEFAULT_SPEED}},
+};
+
+struct result {
+    double gain, jitter, lag, overshoot;
+    int reversals;
+};
+
+static struct trace {
+    int n, m;
+    int16_t (*d)[2];
+    bool *start;
+} trace;
+
+static double trace_cpi = RESOLUTION, trace_rotation = POINTER_ROTATION;
+static double rate = 1000.0 / POLLING_INTERVAL;
+static const char *directory;
+
+/* Parse a list of values, or ranges of values, for parameter p. */
+
+static bool parse(struct parameter *p, const char *s)
+{
+    char *end;
+
+    p->n = 0;
+
+    for (;;) {
+        double first = strtod(s, &end), last = first, step = 1;
+
+        if (end == s) {
+            return false;
+        }
+
+        if (*end == ':') {
+            s = end + 1;
+            last = strtod(s, &end);
+
+            if (end == s || *end != ':') {
+                return false;
+            }
+
+            s = end + 1;
+            step = strtod(s, &end);
+
+            if (end == s || step <= 0 || last < first) {
+                return false;
+            }
+        }
+
+        /* Allow for rounding error in the steps, so that the last
+         * value is included. */
+
+        for (int i = 0; first + i * step <= last + step * 1e-6; i++) {
+            if (p->n == MAX_VALUES) {
+                return false;
+            }
+
+            p->values[p->n++] = first + i * step;
+        }
+
+        if (*end == '\0') {
+            return true;
+        } else if (*end != ',') {
+            return false;
+        }
+
+        s = end + 1;
+    }
+}
+
+static void append(int16_t dx, int16_t dy)
+{
+    if (trace.n == trace.m) {
+        trace.m = trace.m ? 2 * trace.m : 1024;
+        trace.d = realloc(trace.d, trace.m * sizeof(trace.d[0]));
+    }
+
+    trace.d[trace.n][0] = dx;
+    trace.d[trace.n][1] = dy;
+    trace.n += 1;
+}
+
+/* Append the motion in f to the trace, followed by a pause, so that
+ * recordings don't run into each other, and any motion still pending
+ * in the filter is flushed at the end. */
+
+static void load(FILE *f)
+{
+    int dx, dy;
+
+    while (fscanf(f, "%d %d", &dx, &dy) == 2) {
+        append(dx, dy);
+    }
+
+    for (int i = 0; i < rate * PAUSE / 1000; i++) {
+        append(0, 0);
+    }
+}
+
+/* Mark the frames where movements begin, i.e. those with motion,
+ * after a pause, or at the beginning of the trace. */
+
+static void segment(void)
+{
+    int idle = INT32_MAX;
+
+    trace.start = calloc(trace.n, sizeof(trace.start[0]));
+
+    for (int i = 0; i < trace.n; i++) {
+        if (trace.d[i][0] == 0 && trace.d[i][1] == 0) {
+            idle += idle < INT32_MAX;
+        } else {
+            trace.start[i] = (idle >= rate * PAUSE / 1000);
+            idle = 0;
+        }
+    }
+}
+
+/* The gain applied to the sensitivity, at a speed of v inches/s. */
+
+static double accelerate(const double *x, double v)
+{
+    const double g = 1 + x[ACCELERATION] * fmax(v - x[THRESHOLD], 0);
+
+    if (x[MAXIMUM] > 0 && g > x[MAXIMUM]) {
+        return x[MAXIMUM];
+    }
+
+    return g;
+}
+
+static const struct variant *find_variant(double frames)
+{
+    for (size_t i = 0; i < sizeof(variants) / sizeof(variants[0]); i++) {
+        if (variants[i].frames == frames) {
+            return &variants[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* The mean overshoot, over all movements, of the cursor path p. */
+
+static double overshoot(double (*p)[2])
+{
+    double sum = 0;
+    int n = 0;
+
+    for (int a = 0; a < trace.n; a++) {
+        if (!trace.start[a]) {
+            continue;
+        }
+
+        /* The movement lasts until the next one begins, by which time
+         * the cursor has come to rest. */
+
+        int b = a + 1;
+
+        while (b < trace.n && !trace.start[b]) {
+            b += 1;
+        }
+
+        const double *p_0 = a > 0 ? p[a - 1] : (const double[2]){0, 0};
+        const double *p_1 = p[b - 1];
+        const double l = hypot(p_1[0] - p_0[0], p_1[1] - p_0[1]);
+        double s = 0;
+
+        if (l == 0) {
+            continue;
+        }
+
+        for (int i = a; i < b; i++) {
+            s = fmax(s, ((p[i][0] - p_1[0]) * (p_1[0] - p_0[0])
+                         + (p[i][1] - p_1[1]) * (p_1[1] - p_0[1])) / l);
+        }
+
+        sum += s;
+        n += 1;
+    }
+
+    return n > 0 ? sum / n : 0;
+}
+
+static FILE *create(int i, const char *suffix)
+{
+    char path[4096];
+
+    snprintf(path, sizeof(path), "%s/%d.%s", directory, i, suffix);
+
+    FILE *f = fopen(path, "w");
+
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+
+    return f;
+}
+
+/* Replay the trace through grid point i, with parameters x. */
+
+static void simulate(int i, const double *x, struct result *r)
+{
+    const struct variant *f = find_variant(x[FRAMES]);
+    const double theta = (x[ROTATION] - trace_rotation) * M_PI / 180;
+    const double scale = x[CPI] / trace_cpi;
+    double (*p)[2] = calloc(trace.n, sizeof(p[0]));
+    double (*q)[2] = calloc(trace.n, sizeof(q[0]));
+    double bins[BINS][2] = {{0}};
+    double carry[2] = {0, 0}, remainder[2] = {0, 0}, v[2] = {0, 0};
+    double cursor[2] = {0, 0}, ideal[2] = {0, 0};
+    double distance = 0, output = 0, jitter = 0, lag = 0, speed = 0;
+    int16_t last[2] = {0, 0};
+
+    smoothing_alpha = x[ALPHA];
+    smoothing_speed = x[SPEED];
+    r->reversals = 0;
+
+    for (int k = 0; k < trace.n; k++) {
+        const double dx = trace.d[k][0], dy = trace.d[k][1];
+        const double inches = hypot(dx, dy) / trace_cpi;
+        const double d[2] = {
+            scale * (dx * cos(theta) - dy * sin(theta)),
+            scale * (dx * sin(theta) + dy * cos(theta))
+        };
+        int16_t c[2], s[4], o[2];
+
+        /* Sense the motion at the candidate resolution, carrying
+         * fractions of a count over, and pass it through axes.c,
+         * which flips the Y axis, as for the firmware. */
+
+        for (int j = 0; j < 2; j++) {
+            carry[j] += d[j];
+            c[j] = fmax(fmin(trunc(carry[j]), INT16_MAX), -INT16_MAX);
+            carry[j] -= c[j];
+        }
+
+        f->update(c[0], c[1], false);
+        f->get(s, INT16_MAX);
+
+        /* Scale the counts to report units, with the gain depending
+         * on the speed of the smoothed motion, and report whole
+         * units, carrying the rest over, as in axes.c. */
+
+        const double g = x[SENSITIVITY] * accelerate(
+            x, hypot(s[0], s[1]) / x[CPI] * rate);
+        const double h = x[SENSITIVITY] * accelerate(x, inches * rate);
+
+        for (int j = 0; j < 2; j++) {
+            remainder[j] += g * s[j];
+            o[j] = trunc(remainder[j]);
+            remainder[j] -= o[j];
+
+            cursor[j] += o[j];
+            ideal[j] += h * (j == 0 ? d[j] : -d[j]);
+
+            const double a = o[j] - v[j];
+
+            jitter += a * a;
+            v[j] = o[j];
+
+            if (o[j] != 0) {
+                if ((o[j] > 0) != (last[j] > 0) && last[j] != 0) {
+                    r->reversals += 1;
+                }
+
+                last[j] = o[j];
+            }
+
+            p[k][j] = cursor[j];
+            q[k][j] = ideal[j];
+        }
+
+        /* Measure the output along the direction of the ball's
+         * motion, since the length of the (quantized) cursor path
+         * overestimates it. */
+
+        if (inches > 0) {
+            const int b = fmin(inches * rate, BINS - 1);
+            const double l = (o[0] * d[0] - o[1] * d[1]) / hypot(d[0], d[1]);
+
+            bins[b][0] += inches;
+            bins[b][1] += l;
+
+            distance += inches;
+            output += l;
+        }
+
+        lag += hypot(cursor[0] - ideal[0], cursor[1] - ideal[1]);
+        speed += h * hypot(d[0], d[1]);
+    }
+
+    r->gain = distance > 0 ? output / distance : 0;
+    r->jitter = sqrt(jitter / trace.n);
+    r->lag = speed > 0 ? lag / speed : 0;
+    r->overshoot = overshoot(p);
+
+    if (directory) {
+        FILE *s = create(i, "path");
+
+        for (int k = 0; k < trace.n; k++) {
+            fprintf(s, "%g %g %g %g\n", p[k][0], p[k][1], q[k][0], q[k][1]);
+        }
+
+        fclose(s);
+        s = create(i, "gain");
+
+        for (int b = 0; b < BINS; b++) {
+            if (bins[b][0] > 0) {
+                fprintf(s, "%d %g\n", b, bins[b][1] / bins[b][0]);
+            }
+        }
+
+        fclose(s);
+    }
+
+    free(p);
+    free(q);
+}
+
+/* Get the parameters of grid point i. */
+
+static void point(int i, double *x)
+{
+    for (int j = PARAMETERS - 1; j >= 0; j--) {
+        x[j] = parameters[j].values[i % parameters[j].n];
+        i /= parameters[j].n;
+    }
+}
+
+static void reap(void)
+{
+    int status;
+
+    if (wait(&status) < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+        fprintf(stderr, "A simulation failed.\n");
+        exit(1);
+    }
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [-c CPI] [-s SENSITIVITY] [-a DEGREES] [-g GAIN] "
+            "[-t SPEED]\n"
+            "       [-m GAIN] [-f FRAMES] [-l ALPHA] [-v SPEED] [-C CPI] "
+            "[-A DEGREES]\n"
+            "       [-r RATE] [-j JOBS] [-o DIR] [FILE...]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    int c, n = 1;
+
+    while ((c = getopt(argc, argv, "c:s:a:g:t:m:f:l:v:C:A:r:j:o:")) != -1) {
+        int j;
+
+        for (j = 0; j < PARAMETERS && parameters[j].option != c; j++);
+
+        if (j < PARAMETERS) {
+            if (!parse(&parameters[j], optarg)) {
+                fprintf(stderr, "Invalid %s: %s\n", parameters[j].name,
+                        optarg);
+                return 1;
+            }
+
+            continue;
+        }
+
+        switch (c) {
+        case 'C':
+            trace_cpi = atof(optarg);
+            break;
+
+        case 'A':
+            trace_rotation = atof(optarg);
+            break;
+
+        case 'r':
+            rate = atof(optarg);
+            break;
+
+        case 'j':
+            jobs = atol(optarg);
+            break;
+
+        case 'o':
+            directory = optarg;
+            break;
+
+        default:
+            usage(argv[0]);
+        }
+    }
+
+    if (trace_cpi <= 0 || rate <= 0 || jobs < 1) {
+        usage(argv[0]);
+    }
+
+    for (int j = 0; j < PARAMETERS; j++) {
+        for (int k = 0; k < parameters[j].n; k++) {
+            const double y = parameters[j].values[k];
+
+            if ((j == FRAMES && !find_variant(y))
+                || (j == CPI && y <= 0)
+                || (j == SPEED && y <= 0)
+                || (j == ALPHA && (y < 0 || y > 256))) {
+                fprintf(stderr, "Unsupported %s: %g\n", parameters[j].name, y);
+                return 1;
+            }
+        }
+
+        n *= parameters[j].n;
+    }
+
+    if (directory && mkdir(directory, 0777) < 0 && errno != EEXIST) {
+        perror(directory);
+        return 1;
+    }
+
+    /* Load the trace. */
+
+    if (optind == argc) {
+        load(stdin);
+    }
+
+    for (int i = optind; i < argc; i++) {
+        FILE *f = fopen(argv[i], "r");
+
+        if (!f) {
+            perror(argv[i]);
+            return 1;
+        }
+
+        load(f);
+        fclose(f);
+    }
+
+    segment();
+
+    /* Simulate each grid point in a process of its own, which also
+     * gives each a fresh copy of the state of axes.c.  The results
+     * are collected in shared memory. */
+
+    struct result *results = mmap(NULL, n * sizeof(results[0]),
+                                  PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (results == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    fflush(stdout);
+
+    for (int i = 0, running = 0; i < n || running > 0; ) {
+        if (i == n || running == jobs) {
+            reap();
+            running -= 1;
+
+            continue;
+        }
+
+        const pid_t pid = fork();
+
+        if (pid < 0) {
+            perror("fork");
+            return 1;
+        } else if (pid == 0) {
+            double x[PARAMETERS];
+
+            point(i, x);
+            simulate(i, x, &results[i]);
+            _exit(0);
+        }
+
+        i += 1;
+        running += 1;
+    }
+
+    /* Print the results, in grid order. */
+
+    printf("#point\t");
+
+    for (int j = 0; j < PARAMETERS; j++) {
+        printf("%s\t", parameters[j].name);
+    }
+
+    printf("gain\tjitter\treversals\tlag\tovershoot\n");
+
+    for (int i = 0; i < n; i++) {
+        const struct result *r = &results[i];
+        double x[PARAMETERS];
+
+        point(i, x);
+        printf("%d\t", i);
+
+        for (int j = 0; j < PARAMETERS; j++) {
+            printf("%g\t", x[j]);
+        }
+
+        printf("%.1f\t%.3f\t%d\t%.2f\t%.2f\n", r->gain, r->jitter,
+               r->reversals, r->lag, r->overshoot);
+    }
+
+    return 0;
+}
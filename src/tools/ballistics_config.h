@@ -0,0 +1,30 @@
+/* Configuration overrides for the ballistics tool's builds of axes.c.
+ * Like axes_config.h, this header is force-included ahead of axes.c.
+ *
+ * Pointer motion is reported in sensor counts, and the tool applies
+ * the sensitivity (and any acceleration) itself, so that it can be
+ * varied at run time.  The smoothing parameters are likewise read
+ * from variables set by the tool, except for the number of frames,
+ * which sizes the filter's state.  It is set with BALLISTICS_FRAMES,
+ * and axes.c is compiled once for each value (see the Makefile). */
+
+#include <stdint.h>
+
+#include "config.h"
+
+#undef POINTER_SENSITIVITY
+#define POINTER_SENSITIVITY 1
+
+/* Twist isn't simulated. */
+
+#undef TWIST_SENSOR_SS
+
+#undef SMOOTHING_FRAMES
+#undef SMOOTHING_ALPHA
+#undef SMOOTHING_SPEED
+
+#define SMOOTHING_FRAMES BALLISTICS_FRAMES
+#define SMOOTHING_ALPHA smoothing_alpha
+#define SMOOTHING_SPEED smoothing_speed
+
+extern int32_t smoothing_alpha, smoothing_speed;
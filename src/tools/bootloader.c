@@ -0,0 +1,133 @@
+/* Restart Orbs into their bootloader, so that they can be flashed
+ * without pressing the reset button, through Linux's hidraw
+ * interface.  This needs firmware built with ENABLE_BOOTLOADER_JUMP
+ * (see config.h).
+ *
+ * Usage: bootloader [DEVICE...]
+ *
+ * DEVICE is a hidraw node, e.g. /dev/hidraw3.  Without any, all
+ * hidraw nodes are tried.  Nodes are skipped, unless they have the
+ * vendor and product IDs set in config.h, and a report descriptor
+ * with the bootloader report, as parsed by LUFA's HID report parser,
+ * so that only the mouse interface of Orbs that support the jump is
+ * written to.  Each node that was restarted is printed, one per line
+ * (see flash.sh), and the exit status is non-zero if there were
+ * none. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <glob.h>
+#include <sys/ioctl.h>
+#include <linux/hidraw.h>
+
+#include "lufa_host.h"
+
+#define __INCLUDE_FROM_USB_DRIVER
+#define __INCLUDE_FROM_HID_DRIVER
+#include "LUFA/Drivers/USB/Class/Common/HIDParser.h"
+
+#include "reports_host.h"
+
+bool CALLBACK_HIDParser_FilterHIDReportItem(HID_ReportItem_t *const item)
+{
+    return true;
+}
+
+static bool is_orb(int fd)
+{
+    struct hidraw_devinfo info;
+    struct hidraw_report_descriptor d;
+    static HID_ReportInfo_t parsed;
+    int size;
+
+    if (ioctl(fd, HIDIOCGRAWINFO, &info) < 0
+        || (uint16_t)info.vendor != VENDOR_ID
+        || (uint16_t)info.product != PRODUCT_ID) {
+        return false;
+    }
+
+    if (ioctl(fd, HIDIOCGRDESCSIZE, &size) < 0) {
+        return false;
+    }
+
+    d.size = size;
+
+    if (ioctl(fd, HIDIOCGRDESC, &d) < 0
+        || USB_ProcessHIDReport(d.value, d.size, &parsed)
+        != HID_PARSE_Successful) {
+        return false;
+    }
+
+    /* Look for the bootloader report's field. */
+
+    for (int i = 0; i < parsed.TotalReportItems; i++) {
+        const HID_ReportItem_t *item = &parsed.ReportItems[i];
+
+        if (item->ReportID == REPORT_ID_BOOTLOADER
+            && item->ItemType == HID_REPORT_ITEM_Feature
+            && item->Attributes.Usage.Page == 0xff00
+            && item->Attributes.Usage.Usage == 0x03) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool restart(const char *path)
+{
+    const uint8_t r[1 + sizeof(BootloaderReport_Data_t)] = {
+        REPORT_ID_BOOTLOADER, BOOTLOADER_KEY
+    };
+    bool done = false;
+    int fd;
+
+    if ((fd = open(path, O_RDWR)) < 0) {
+        perror(path);
+        return false;
+    }
+
+    if (is_orb(fd)) {
+        if (ioctl(fd, HIDIOCSFEATURE(sizeof(r)), r) < 0) {
+            perror(path);
+        } else {
+            printf("%s\n", path);
+            done = true;
+        }
+    }
+
+    close(fd);
+
+    return done;
+}
+
+int main(int argc, char **argv)
+{
+    int n = 0;
+
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            n += restart(argv[i]);
+        }
+    } else {
+        glob_t g;
+
+        if (glob("/dev/hidraw*", 0, NULL, &g) == 0) {
+            for (size_t i = 0; i < g.gl_pathc; i++) {
+                n += restart(g.gl_pathv[i]);
+            }
+
+            globfree(&g);
+        }
+    }
+
+    if (n == 0) {
+        fprintf(stderr, "No Orbs were restarted.\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,139 @@
+/* Capture the telemetry stream of an Orb, built with ENABLE_TELEMETRY,
+ * through Linux's hidraw interface.
+ *
+ * Usage: capture DEVICE [FILE]
+ *
+ * DEVICE is the hidraw node of the telemetry interface, e.g.
+ * /dev/hidraw3.  The reports (see telemetry.h) are written to FILE as
+ * is, back to back, or, without FILE, printed to the standard output
+ * in text form.  Reports lost along the way, as detected through gaps
+ * in the sequence numbers, are counted and reported on exit. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "telemetry.h"
+
+static volatile sig_atomic_t done;
+
+static void stop(int signal)
+{
+    done = 1;
+}
+
+static unsigned int get(const uint8_t *p, int n)
+{
+    unsigned int x = 0;
+
+    for (int i = n - 1; i >= 0; i--) {
+        x = x << 8 | p[i];
+    }
+
+    return x;
+}
+
+static void print(const uint8_t *b)
+{
+    const struct telemetry *t = (const struct telemetry *)b;
+
+    /* The stream is little-endian, so decode it explicitly, rather
+     * than relying on the host's byte order. */
+
+    printf("%5u %3u %02x %6d %6d %3u %3u-%3u %5u %5u %02x %3u%% %u\n",
+           get(b + offsetof(struct telemetry, sequence), 2),
+           t->frames, t->motion,
+           (int16_t)get(b + offsetof(struct telemetry, delta_x), 2),
+           (int16_t)get(b + offsetof(struct telemetry, delta_y), 2),
+           t->squal, t->minimum_raw, t->maximum_raw,
+           get(b + offsetof(struct telemetry, shutter), 2),
+           get(b + offsetof(struct telemetry, resolution), 2),
+           t->buttons, t->utilization,
+           get(b + offsetof(struct telemetry, overruns), 2));
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t b[sizeof(struct telemetry)];
+    unsigned long n = 0, lost = 0;
+    int first = 1;
+    unsigned int last = 0;
+    FILE *f = NULL;
+    int fd;
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s DEVICE [FILE]\n", argv[0]);
+        return 1;
+    }
+
+    if ((fd = open(argv[1], O_RDONLY)) < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    if (argc > 2 && !(f = fopen(argv[2], "wb"))) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+
+    if (!f) {
+        printf("%5s %3s %2s %6s %6s %3s %7s %5s %5s %2s %4s %s\n",
+               "Seq", "Frm", "M", "DX", "DY", "SQ", "Raw", "Shut", "CPI",
+               "B", "CPU", "Overruns");
+    }
+
+    while (!done) {
+        const ssize_t r = read(fd, b, sizeof(b));
+
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            perror(argv[1]);
+            break;
+        }
+
+        if (r == 0) {
+            break;
+        }
+
+        if (r != sizeof(b)) {
+            fprintf(stderr, "Unexpected report size %zd; is this the "
+                    "telemetry interface?\n", r);
+            break;
+        }
+
+        const unsigned int s = get(b, 2);
+
+        if (!first) {
+            lost += (uint16_t)(s - last - 1);
+        }
+
+        first = 0;
+        last = s;
+        n += 1;
+
+        if (f) {
+            fwrite(b, sizeof(b), 1, f);
+        } else {
+            print(b);
+        }
+    }
+
+    if (f) {
+        fclose(f);
+    }
+
+    fprintf(stderr, "%lu reports captured, %lu lost.\n", n, lost);
+
+    return 0;
+}
@@ -0,0 +1,48 @@
+#ifndef _CHECK_H_
+#define _CHECK_H_
+
+/* Helpers shared by the tools that check parts of the firmware on the
+ * host (see make check).  Each check is printed as a row of a table,
+ * with the value it got, the value it expected and whether they
+ * agree. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* Print the table's header. */
+
+static inline void check_header(void)
+{
+    printf("%-40s %8s %8s\n", "Check", "Got", "Expected");
+}
+
+/* Print a row, and return whether got is within tolerance of
+ * expected. */
+
+static inline bool check(const char *name, long got, long expected,
+                         long tolerance)
+{
+    const bool ok = (labs(got - expected) <= tolerance);
+
+    printf("%-40s %8ld %8ld  %s\n", name, got, expected, ok ? "ok" : "FAIL");
+
+    return ok;
+}
+
+/* A pseudo-random number in [0, n), for step i of sequence k, the
+ * same every time. */
+
+static inline uint32_t noise(uint32_t i, uint32_t k, uint32_t n)
+{
+    uint32_t x = (i * 4 + k) * 2654435761u;
+
+    x ^= x >> 15;
+    x *= 2246822519u;
+    x ^= x >> 13;
+
+    return x % n;
+}
+
+#endif
@@ -0,0 +1,382 @@
+/* Check the mouse interface's report descriptor against the layout of
+ * the reports that the firmware sends, on the host, with LUFA's HID
+ * report parser.
+ *
+ * Usage: descriptor [-n COUNT] [-s SEED]
+ *
+ * The descriptor (MouseReport, in reports.h) is parsed, and the
+ * following is checked:
+ *
+ * - It parses without errors, and each report (pointer, scroll and
+ *   feature) has the size of the struct it is sent as.
+ *
+ * - Each input report, with its ID, fits the mouse endpoint, so that
+ *   it's sent in a single packet, as does the boot protocol report.
+ *
+ * - Each field is at the offset of, and has the size and range of,
+ *   the corresponding struct member, and there are no other fields.
+ *   Constant (read-only) fields are skipped by the parser, so these
+ *   are only checked through the size of their report.
+ *
+ * Then COUNT random reports (1000000 by default) of each kind are
+ * fuzzed through the parser: they're filled in through the structs,
+ * as the firmware does, and decoded field by field, and, conversely,
+ * random field values are encoded by the parser and compared to the
+ * struct.  SEED seeds the random number generator.
+ *
+ * The exit status is non-zero if any check fails, so that the check
+ * can be run as part of the firmware's build (see the Makefile). */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lufa_host.h"
+
+#define __INCLUDE_FROM_USB_DRIVER
+#define __INCLUDE_FROM_HID_DRIVER
+#include "LUFA/Drivers/USB/Class/Common/HIDParser.h"
+
+#include "reports_host.h"
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The reports are little-endian, as is the device, and so must be the host."
+#endif
+
+#define MAX_FIELDS 16
+#define MAX_REPORT 64
+
+/* A field of a report, as laid out by the struct the report is sent
+ * as. */
+
+struct field {
+    const char *name;
+    uint8_t id, type;
+    uint16_t page, usage;
+    size_t offset;
+    uint8_t shift, bits;
+    int32_t minimum, maximum;
+    HID_ReportItem_t *item;
+};
+
+static const struct report {
+    const char *name;
+    uint8_t id, type;
+    size_t size;
+} reports[] = {
+    {"pointer", REPORT_ID_POINTER, HID_REPORT_ITEM_In,
+     sizeof(PointerReport_Data_t)},
+    {"scroll", REPORT_ID_SCROLL, HID_REPORT_ITEM_In,
+     sizeof(ScrollReport_Data_t)},
+    {"feature", REPORT_ID_FEATURE, HID_REPORT_ITEM_Feature,
+     sizeof(FeatureReport_Data_t)},
+#ifdef ENABLE_BOOTLOADER_JUMP
+    {"bootloader", REPORT_ID_BOOTLOADER, HID_REPORT_ITEM_Feature,
+     sizeof(BootloaderReport_Data_t)},
+#endif
+};
+
+#define FIELD(n, i, t, p, u, s, m, k, b, l, h)                          \
+    {n, i, t, p, u, offsetof(s, m), k, b, l, h, NULL}
+
+static struct field fields[MAX_FIELDS] = {
+    FIELD("X", REPORT_ID_POINTER, HID_REPORT_ITEM_In, 0x01, 0x30,
+          PointerReport_Data_t, axes[0], 0, 16, INT16_MIN, INT16_MAX),
+    FIELD("Y", REPORT_ID_POINTER, HID_REPORT_ITEM_In, 0x01, 0x31,
+          PointerReport_Data_t, axes[1], 0, 16, INT16_MIN, INT16_MAX),
+    FIELD("AC pan", REPORT_ID_SCROLL, HID_REPORT_ITEM_In, 0x0c, 0x238,
+          ScrollReport_Data_t, axes[0], 0, 16, INT16_MIN, INT16_MAX),
+    FIELD("wheel", REPORT_ID_SCROLL, HID_REPORT_ITEM_In, 0x01, 0x38,
+          ScrollReport_Data_t, axes[1], 0, 16, INT16_MIN, INT16_MAX),
+    FIELD("resolution multiplier", REPORT_ID_FEATURE,
+          HID_REPORT_ITEM_Feature, 0x01, 0x48,
+          FeatureReport_Data_t, multiplier, 0, 2, 0, 1),
+#ifdef ENABLE_BOOTLOADER_JUMP
+    FIELD("bootloader key", REPORT_ID_BOOTLOADER, HID_REPORT_ITEM_Feature,
+          0xff00, 0x03, BootloaderReport_Data_t, key, 0, 8, 0, 255),
+#endif
+};
+
+static int n_fields, failures;
+static uint32_t state = 1;
+
+static HID_ReportInfo_t info;
+
+bool CALLBACK_HIDParser_FilterHIDReportItem(HID_ReportItem_t *const item)
+{
+    return true;
+}
+
+static void __attribute__((format(printf, 1, 2))) fail(
+    const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    vfprintf(stderr, format, ap);
+    va_end(ap);
+
+    failures += 1;
+}
+
+/* A xorshift generator, which is quick enough not to dominate the
+ * fuzzing. */
+
+static uint32_t random32(void)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+
+    return state;
+}
+
+static uint32_t mask(uint8_t bits)
+{
+    return bits < 32 ? ((uint32_t)1 << bits) - 1 : UINT32_MAX;
+}
+
+/* Get or set field f of a report, as the struct lays it out. */
+
+static uint32_t get(const uint8_t *data, const struct field *f)
+{
+    uint32_t x = 0;
+
+    memcpy(&x, data + f->offset, (f->shift + f->bits + 7) / 8);
+
+    return (x >> f->shift) & mask(f->bits);
+}
+
+static void set(uint8_t *data, const struct field *f, uint32_t x)
+{
+    uint32_t y = 0;
+    const size_t n = (f->shift + f->bits + 7) / 8;
+
+    memcpy(&y, data + f->offset, n);
+    y = (y & ~(mask(f->bits) << f->shift)) | (x & mask(f->bits)) << f->shift;
+    memcpy(data + f->offset, &y, n);
+}
+
+static void check_layout(void)
+{
+    const uint8_t e = USB_ProcessHIDReport(MouseReport, sizeof(MouseReport),
+                                           &info);
+
+    if (e != HID_PARSE_Successful) {
+        fail("The descriptor failed to parse (error %d).\n", e);
+        return;
+    }
+
+    /* The reports. */
+
+    for (size_t i = 0; i < sizeof(reports) / sizeof(reports[0]); i++) {
+        const struct report *r = &reports[i];
+        const uint16_t n = USB_GetHIDReportSize(&info, r->id, r->type);
+
+        if (n != r->size) {
+            fail("The %s report is %u bytes long, but its struct is %zu.\n",
+                 r->name, n, r->size);
+        }
+
+        if (r->type == HID_REPORT_ITEM_In && n + 1 > MOUSE_EPSIZE) {
+            fail("The %s report, with its ID, doesn't fit the %d byte "
+                 "endpoint.\n", r->name, MOUSE_EPSIZE);
+        }
+    }
+
+    if (sizeof(BootReport_Data_t) != 3) {
+        fail("The boot protocol report is %zu bytes long, instead of 3.\n",
+             sizeof(BootReport_Data_t));
+    }
+
+    /* The fields. */
+
+    for (int i = 0; i < info.TotalReportItems; i++) {
+        HID_ReportItem_t *item = &info.ReportItems[i];
+        struct field *f = NULL;
+
+        for (int j = 0; j < n_fields; j++) {
+            if (fields[j].id == item->ReportID
+                && fields[j].type == item->ItemType
+                && fields[j].page == item->Attributes.Usage.Page
+                && fields[j].usage == item->Attributes.Usage.Usage) {
+                f = &fields[j];
+                break;
+            }
+        }
+
+        if (!f) {
+            fail("Unexpected field in report %d: usage %04x:%04x.\n",
+                 item->ReportID, item->Attributes.Usage.Page,
+                 item->Attributes.Usage.Usage);
+            continue;
+        }
+
+        if (f->item) {
+            fail("Duplicate %s field.\n", f->name);
+        }
+
+        f->item = item;
+
+        if (item->BitOffset != 8 * f->offset + f->shift
+            || item->Attributes.BitSize != f->bits) {
+            fail("The %s field is at bit %u, with %u bits, but the struct "
+                 "has it at bit %zu, with %u bits.\n", f->name,
+                 item->BitOffset, item->Attributes.BitSize,
+                 8 * f->offset + f->shift, f->bits);
+        }
+
+        /* The parser doesn't sign-extend the limits, so compare them
+         * within the size of the field. */
+
+        const uint32_t m = mask(f->bits);
+
+        if ((item->Attributes.Logical.Minimum & m) != ((uint32_t)f->minimum & m)
+            || (item->Attributes.Logical.Maximum & m)
+            != ((uint32_t)f->maximum & m)) {
+            fail("The %s field's logical range doesn't match its struct "
+                 "member.\n", f->name);
+        }
+    }
+
+    for (int j = 0; j < n_fields; j++) {
+        if (!fields[j].item) {
+            fail("The %s field is missing.\n", fields[j].name);
+        }
+    }
+}
+
+/* Fuzz n reports of kind r, both ways, through the parser. */
+
+static void fuzz(const struct report *r, long n)
+{
+    struct field *f[MAX_FIELDS];
+    uint8_t a[MAX_REPORT], b[MAX_REPORT];
+    uint32_t x[MAX_FIELDS];
+    int k = 0;
+
+    for (int j = 0; j < n_fields; j++) {
+        if (fields[j].id == r->id && fields[j].type == r->type
+            && fields[j].item) {
+            f[k++] = &fields[j];
+        }
+    }
+
+    for (long i = 0; i < n && !failures; i++) {
+        /* Decode random report data, including any padding. */
+
+        a[0] = r->id;
+
+        for (size_t j = 0; j < r->size; j++) {
+            a[j + 1] = random32();
+        }
+
+        for (int j = 0; j < k; j++) {
+            if (!USB_GetHIDReportItemInfo(a, f[j]->item)) {
+                fail("The %s field wasn't found in a %s report.\n",
+                     f[j]->name, r->name);
+            } else if (f[j]->item->Value != get(a + 1, f[j])) {
+                fail("The %s field was decoded as %x instead of %x.\n",
+                     f[j]->name, f[j]->item->Value, get(a + 1, f[j]));
+            }
+        }
+
+        /* Encode random field values, with the padding left zero. */
+
+        memset(a, 0, r->size + 1);
+        memset(b, 0, r->size + 1);
+        b[0] = r->id;
+
+        for (int j = 0; j < k; j++) {
+            x[j] = random32() & mask(f[j]->bits);
+            f[j]->item->Value = x[j];
+
+            USB_SetHIDReportItemInfo(a, f[j]->item);
+            set(b + 1, f[j], x[j]);
+        }
+
+        if (memcmp(a, b, r->size + 1) != 0) {
+            fail("A %s report was encoded differently from its struct.\n",
+                 r->name);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    long n = 1000000;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:s:")) != -1) {
+        switch (c) {
+        case 'n':
+            n = atol(optarg);
+            break;
+
+        case 's':
+            state = strtoul(optarg, NULL, 0);
+            break;
+
+        default:
+            fprintf(stderr, "Usage: %s [-n COUNT] [-s SEED]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (state == 0) {
+        state = 1;
+    }
+
+    /* The buttons are one bit each, with usages counting up from
+     * 1. */
+
+    while (fields[n_fields].name) {
+        n_fields += 1;
+    }
+
+    for (unsigned int i = 0; i < BUTTON_COUNT; i++) {
+        static char names[8][16];
+
+        snprintf(names[i], sizeof(names[i]), "button %u", i + 1);
+        fields[n_fields++] = (struct field)FIELD(
+            names[i], REPORT_ID_POINTER, HID_REPORT_ITEM_In, 0x09, i + 1,
+            PointerReport_Data_t, buttons, i, 1, 0, 1);
+    }
+
+    check_layout();
+
+    if (failures == 0) {
+        struct timespec t_0, t_1;
+
+        clock_gettime(CLOCK_MONOTONIC, &t_0);
+
+        for (size_t i = 0; i < sizeof(reports) / sizeof(reports[0]); i++) {
+            fuzz(&reports[i], n);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &t_1);
+
+        const double t = (t_1.tv_sec - t_0.tv_sec
+                          + (t_1.tv_nsec - t_0.tv_nsec) * 1e-9);
+
+        printf("Fuzzed %ld reports of each kind in %.2f s "
+               "(%.0f reports/s).\n", n, t,
+               t > 0 ? n * (sizeof(reports) / sizeof(reports[0])) / t : 0);
+    }
+
+    if (failures > 0) {
+        fprintf(stderr, "%d check%s failed.\n", failures,
+                failures == 1 ? "" : "s");
+        return 1;
+    }
+
+    printf("The report descriptor matches the report structs.\n");
+
+    return 0;
+}
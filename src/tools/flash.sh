@@ -0,0 +1,139 @@
+#!/bin/sh
+
+# Flash firmware onto every Orb attached to this host, in parallel.
+#
+# Usage: flash.sh [-a] [HEX]
+#
+# Orbs running firmware built with ENABLE_BOOTLOADER_JUMP are first
+# restarted into their bootloader, with the bootloader tool, which
+# should have been built (see the Makefile).  Once they have all
+# reappeared as DFU devices, they're flashed with HEX (../main.hex by
+# default), as make install does, but all at once.  Only the devices
+# that appeared after the restart are flashed, as any other device
+# with the same ID, already in its bootloader, need not be an Orb.
+# With -a, those are flashed as well, say after pressing reset on an
+# Orb without the bootloader jump.  The output for each device is
+# shown only if it fails, and the exit status is non-zero if any did.
+#
+# Devices are addressed by USB bus and address, which needs
+# dfu-programmer 0.7 or later, and are found with lsusb.  Access to
+# the hidraw and USB device nodes is needed, which usually means
+# running as root.
+
+set -u
+
+all=false
+
+while getopts a o; do
+    case "$o" in
+        a) all=true ;;
+        *) echo "Usage: $0 [-a] [HEX]" >&2; exit 1 ;;
+    esac
+done
+
+shift $((OPTIND - 1))
+
+TOOLS=$(dirname "$0")
+HEX=${1:-$TOOLS/../main.hex}
+MCU=${MCU:-atmega32u4}
+DFU_ID=${DFU_ID:-03eb:2ff4}
+TIMEOUT=${TIMEOUT:-10}
+
+if [ ! -f "$HEX" ]; then
+    echo "$HEX: No such file." >&2
+    exit 1
+fi
+
+if [ ! -x "$TOOLS/bootloader" ]; then
+    echo "$TOOLS/bootloader not found; build it with make." >&2
+    exit 1
+fi
+
+# Print the bus and address of each DFU device, as BUS,ADDRESS.
+
+dfu_devices() {
+    lsusb -d "$DFU_ID" | awk '{sub(":", "", $4); print $2 + 0 "," $4 + 0}'
+}
+
+# Print the DFU devices to flash: all of them with -a, and otherwise
+# only those that weren't there before the restart.
+
+targets() {
+    if $all; then
+        dfu_devices
+    else
+        dfu_devices | grep -vxF "$previous"
+    fi
+}
+
+# Restart all Orbs into the bootloader and wait for them to show up.
+
+previous=$(dfu_devices)
+before=$(printf '%s' "$previous" | grep -c .)
+sent=$("$TOOLS/bootloader" 2>/dev/null | wc -l)
+
+echo "Restarted $sent Orb(s), with $before device(s) already in the" \
+     "bootloader."
+
+if $all; then
+    expected=$((before + sent))
+else
+    expected=$sent
+
+    if [ "$before" -gt 0 ]; then
+        echo "Those already in the bootloader are left alone; use -a to" \
+             "flash them too."
+    fi
+fi
+
+if [ "$expected" -eq 0 ]; then
+    exit 1
+fi
+
+t=0
+
+while [ "$(targets | wc -l)" -lt "$expected" ]; do
+    if [ "$t" -ge "$TIMEOUT" ]; then
+        echo "Only $(targets | wc -l) of $expected devices appeared." >&2
+        break
+    fi
+
+    sleep 1
+    t=$((t + 1))
+done
+
+# Flash them all at once.
+
+LOGS=$(mktemp -d)
+jobs=""
+
+for d in $(targets); do
+    (
+        target="$MCU:$d"
+
+        dfu-programmer "$target" erase &&
+            dfu-programmer "$target" flash "$HEX" &&
+            dfu-programmer "$target" start
+    ) > "$LOGS/$d" 2>&1 &
+
+    jobs="$jobs $!:$d"
+done
+
+failed=0
+
+for j in $jobs; do
+    if wait "${j%%:*}"; then
+        echo "${j#*:}: Done."
+    else
+        echo "${j#*:}: Failed." >&2
+        cat "$LOGS/${j#*:}" >&2
+        failed=$((failed + 1))
+    fi
+done
+
+rm -r "$LOGS"
+
+if [ "$failed" -gt 0 ]; then
+    echo "$failed device(s) failed." >&2
+    exit 1
+fi
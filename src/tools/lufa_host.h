@@ -0,0 +1,31 @@
+#ifndef _LUFA_HOST_H_
+#define _LUFA_HOST_H_
+
+/* Compile parts of LUFA on the host, such as its HID report parser.
+ * LUFA's Common.h, which pulls in the AVR headers, is skipped, by
+ * defining its include guard, and the little it would provide to the
+ * parts used here is defined instead.  The device is the firmware's,
+ * so that LUFA's USB headers see a supported target. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+
+#define __LUFA_COMMON_H__
+
+#define __AVR_ATmega32U4__
+#define ARCH_AVR8 0
+#define ARCH ARCH_AVR8
+
+#define CONCAT(x, y) x ## y
+#define CONCAT_EXPANDED(x, y) CONCAT(x, y)
+#define MAX(x, y) (((x) > (y)) ? (x) : (y))
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+#define ATTR_PACKED __attribute__((packed))
+#define ATTR_CONST __attribute__((const))
+#define ATTR_WARN_UNUSED_RESULT __attribute__((warn_unused_result))
+#define ATTR_NON_NULL_PTR_ARG(...) __attribute__((nonnull(__VA_ARGS__)))
+
+#endif
@@ -0,0 +1,120 @@
+/* Read the cycle profile and RAM usage of a running Orb, built with
+ * ENABLE_PROFILER, and print them.  See profile.c and memory.c in the
+ * firmware.
+ *
+ * Usage: profile [-r]
+ *
+ * With -r, the profile is reset after it has been read.  This requires
+ * libusb (it's not built by default; use "make profile") and,
+ * typically, permission to access the device. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <libusb.h>
+
+#include "config.h"
+
+/* Only the definitions of profile.h are needed here. */
+
+#undef ENABLE_PROFILER
+#include "profile.h"
+#include "memory.h"
+
+static const char *names[PROFILE_STAGES] = {
+    "sensor", "sensor wait", "axes", "HID task", "USB task", "CDC task",
+    "control", "idle"
+};
+
+/* The profile, as laid out by the firmware: little-endian, with no
+ * padding. */
+
+#define STAGE_SIZE (4 + 4 + 2 + 2 * PROFILE_BUCKETS)
+#define PROFILE_SIZE (4 + PROFILE_STAGES * STAGE_SIZE)
+
+static uint32_t get(const uint8_t *p, int n)
+{
+    uint32_t x = 0;
+
+    for (int i = n - 1; i >= 0; i--) {
+        x = x << 8 | p[i];
+    }
+
+    return x;
+}
+
+int main(int argc, char **argv)
+{
+    const int clear = (argc > 1 && !strcmp(argv[1], "-r"));
+    libusb_device_handle *h;
+    uint8_t b[PROFILE_SIZE], m[8];
+    int n;
+
+    if (libusb_init(NULL) < 0) {
+        fprintf(stderr, "Could not initialize libusb.\n");
+        return 1;
+    }
+
+    h = libusb_open_device_with_vid_pid(NULL, VENDOR_ID, PRODUCT_ID);
+
+    if (!h) {
+        fprintf(stderr, "Could not open the device.\n");
+        return 1;
+    }
+
+    n = libusb_control_transfer(
+        h, LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR
+        | LIBUSB_RECIPIENT_DEVICE, PROFILE_REQUEST_READ, 0, 0,
+        b, sizeof(b), 1000);
+
+    if (n != sizeof(b)) {
+        fprintf(stderr, "Could not read the profile (%s).\n",
+                n < 0 ? libusb_error_name(n) : "short read");
+        return 1;
+    }
+
+    if (libusb_control_transfer(
+            h, LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR
+            | LIBUSB_RECIPIENT_DEVICE, MEMORY_REQUEST_READ, 0, 0,
+            m, sizeof(m), 1000) != sizeof(m)) {
+        fprintf(stderr, "Could not read the memory usage.\n");
+        return 1;
+    }
+
+    if (clear) {
+        libusb_control_transfer(
+            h, LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR
+            | LIBUSB_RECIPIENT_DEVICE, PROFILE_REQUEST_RESET, 0, 0,
+            NULL, 0, 1000);
+    }
+
+    libusb_close(h);
+    libusb_exit(NULL);
+
+    const uint32_t elapsed = get(b, 4);
+
+    printf("RAM: %u bytes of .data, %u of .bss, %u of stack "
+           "(high-water mark), %u never used\n",
+           get(m, 2), get(m + 2, 2), get(m + 4, 2), get(m + 6, 2));
+    printf("Elapsed: %u cycles\n\n", elapsed);
+    printf("%-12s %10s %10s %8s %8s %7s   Histogram (from <32 cycles, "
+           "in powers of 2)\n",
+           "Stage", "Count", "Total", "Mean", "Max", "Time %");
+
+    for (int i = 0; i < PROFILE_STAGES; i++) {
+        const uint8_t *p = b + 4 + i * STAGE_SIZE;
+        const uint32_t count = get(p, 4), total = get(p + 4, 4);
+
+        printf("%-12s %10u %10u %8.1f %8u %6.2f%%  ", names[i], count, total,
+               count ? (double)total / count : 0.0, get(p + 8, 2),
+               elapsed ? 100.0 * total / elapsed : 0.0);
+
+        for (int k = 0; k < PROFILE_BUCKETS; k++) {
+            printf(" %u", get(p + 10 + 2 * k, 2));
+        }
+
+        putchar('\n');
+    }
+
+    return 0;
+}
@@ -0,0 +1,17 @@
+/* Configuration overrides for the alternation and stall tools' build
+ * of axes.c.  Like axes_config.h, this header is force-included ahead
+ * of axes.c.
+ *
+ * Motion is scaled by the configured sensitivities, as on the device,
+ * but isn't smoothed, accelerated or quantized to detents, so that
+ * the totals reported can be predicted from the motion fed in. */
+
+#include "config.h"
+
+/* Twist isn't simulated. */
+
+#undef TWIST_SENSOR_SS
+
+#undef SMOOTHING_FRAMES
+#undef WHEEL_ACCELERATION
+#undef WHEEL_DETENTS
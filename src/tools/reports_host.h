@@ -0,0 +1,31 @@
+#ifndef _REPORTS_HOST_H_
+#define _REPORTS_HOST_H_
+
+/* Compile the firmware's report descriptors (see reports.h) on the
+ * host, providing what LUFA and avr-libc would on the device. */
+
+#include <stdint.h>
+
+#include "lufa_host.h"
+
+#define PROGMEM
+
+typedef uint8_t USB_Descriptor_HIDReport_Datatype_t;
+
+/* The buttons are configured by pin, but only their number matters
+ * to the descriptor. */
+
+#define PIND0 0
+#define PIND1 1
+#define PIND2 2
+#define PIND3 3
+#define PIND4 4
+#define PIND5 5
+#define PIND6 6
+#define PIND7 7
+
+#include "config.h"
+#include "LUFA/Drivers/USB/Class/Common/HIDReportData.h"
+#include "reports.h"
+
+#endif
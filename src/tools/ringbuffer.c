@@ -0,0 +1,130 @@
+/* Stress LUFA's lock-free ring buffer (SPSCRingBuffer.h) on the host.
+ *
+ * A producer thread inserts a pseudo-random sequence of bytes into a
+ * buffer, while a consumer thread removes them and checks them against
+ * the same sequence, the way an ISR and the main loop would share the
+ * buffer on the device, without any locking.  Each thread only checks
+ * whether the buffer is full or empty, as it should, and yields when
+ * it can't proceed, so that the two keep interleaving even on a single
+ * CPU.  The consumer also checks that the count never exceeds the
+ * size of the buffer, and that peeking returns the byte about to be
+ * removed.  This is repeated for several buffer sizes.
+ *
+ * The buffer relies on its indices being read and written atomically,
+ * and on stores being seen in program order, as they are on the AVR.
+ * That also holds on x86 hosts, but not necessarily on hosts with a
+ * weaker memory model, where failures don't indicate a problem on the
+ * device.
+ *
+ * Usage: ringbuffer [BYTES]
+ *
+ * BYTES is the number of bytes passed through each buffer (1000000 by
+ * default).  The exit status is non-zero if any check fails. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "LUFA/Drivers/Misc/SPSCRingBuffer.h"
+
+struct run {
+    SPSCRingBuffer_t buffer;
+    uint8_t data[128];
+    uint8_t size;
+    long n, errors, overflows;
+};
+
+/* The byte of the sequence at position i. */
+
+static uint8_t sequence(uint32_t i)
+{
+    uint32_t x = i * 2654435761u;
+
+    x ^= x >> 15;
+    x *= 2246822519u;
+    x ^= x >> 13;
+
+    return (uint8_t)x;
+}
+
+static void *produce(void *p)
+{
+    struct run *r = p;
+
+    for (long i = 0; i < r->n; i++) {
+        while (SPSCRingBuffer_IsFull(&r->buffer)) {
+            sched_yield();
+        }
+
+        SPSCRingBuffer_Insert(&r->buffer, sequence(i));
+    }
+
+    return NULL;
+}
+
+static void *consume(void *p)
+{
+    struct run *r = p;
+
+    for (long i = 0; i < r->n; i++) {
+        while (SPSCRingBuffer_IsEmpty(&r->buffer)) {
+            sched_yield();
+        }
+
+        const uint8_t c = SPSCRingBuffer_GetCount(&r->buffer);
+        const uint8_t x = SPSCRingBuffer_Peek(&r->buffer);
+        const uint8_t y = SPSCRingBuffer_Remove(&r->buffer);
+
+        r->overflows += (c > r->size);
+        r->errors += (x != y || y != sequence(i));
+    }
+
+    return NULL;
+}
+
+static bool run(uint8_t size, long n)
+{
+    struct run r = {.size = size, .n = n};
+    pthread_t producer, consumer;
+    bool ok;
+
+    SPSCRingBuffer_InitBuffer(&r.buffer, r.data, size);
+
+    if (pthread_create(&consumer, NULL, consume, &r) != 0
+        || pthread_create(&producer, NULL, produce, &r) != 0) {
+        perror("pthread_create");
+        exit(1);
+    }
+
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+
+    ok = (r.errors == 0 && r.overflows == 0
+          && SPSCRingBuffer_IsEmpty(&r.buffer));
+
+    printf("%3u-byte buffer: %ld bytes, %ld corrupted, %ld overflows  %s\n",
+           size, n, r.errors, r.overflows, ok ? "ok" : "FAIL");
+
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    const uint8_t sizes[] = {1, 2, 16, 128};
+    const long n = argc > 1 ? atol(argv[1]) : 1000000;
+    bool ok = true;
+
+    for (unsigned int i = 0; i < sizeof(sizes); i++) {
+        ok &= run(sizes[i], n);
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Some checks failed.\n");
+        return 1;
+    }
+
+    return 0;
+}
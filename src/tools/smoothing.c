@@ -0,0 +1,209 @@
+/* Benchmark the pointer smoothing filter of axes.c on the host.
+ *
+ * The axes code is compiled twice, with and without smoothing (see
+ * axes_config.h), and the same motion is fed through both, one
+ * polling interval (frame) at a time.  For each sequence, the jitter
+ * of the resulting motion (the RMS change in velocity between
+ * successive frames, in sensor counts) and the number of direction
+ * reversals, which are perceived as shimmer, are reported for both.
+ * The mean lag of the smoothed motion behind the unsmoothed motion
+ * is also reported, in frames.
+ *
+ * Usage: smoothing [FILE]
+ *
+ * Without arguments, synthetic sequences are used, consisting of
+ * straight motion at various speeds, with added sensor noise.
+ * Otherwise, FILE should contain recorded motion, as one "dx dy" pair
+ * of sensor counts per line, one line per polling interval. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define FRAMES 5000
+#define SIGMA 4
+
+void raw_update_axes(int16_t delta_x, int16_t delta_y, bool scroll);
+bool raw_get_axes(int16_t *p, int16_t limit);
+void smooth_update_axes(int16_t delta_x, int16_t delta_y, bool scroll);
+bool smooth_get_axes(int16_t *p, int16_t limit);
+
+struct trace {
+    const char *name;
+    int n;
+    int16_t (*d)[2];
+};
+
+struct pipeline {
+    void (*update)(int16_t, int16_t, bool);
+    bool (*get)(int16_t *, int16_t);
+    double x[2], v[2], jitter;
+    int16_t last[2];
+    int reversals;
+};
+
+static double gaussian(void)
+{
+    const double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    const double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+/* Straight, diagonal motion at a speed of s counts per frame,
+ * quantized to whole counts, after adding gaussian noise with a
+ * standard deviation of sigma counts. */
+
+static void synthesize(struct trace *t, double s, double sigma)
+{
+    double x[2] = {0, 0};
+    int32_t c[2] = {0, 0};
+
+    t->n = FRAMES;
+    t->d = malloc(t->n * sizeof(t->d[0]));
+
+    for (int i = 0; i < t->n; i++) {
+        for (int j = 0; j < 2; j++) {
+            x[j] += s / sqrt(2);
+
+            const int32_t q = floor(x[j] + sigma * gaussian());
+
+            t->d[i][j] = q - c[j];
+            c[j] = q;
+        }
+    }
+}
+
+static void load(struct trace *t, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    int dx, dy, m = 0;
+
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+
+    t->name = path;
+    t->n = 0;
+    t->d = NULL;
+
+    while (fscanf(f, "%d %d", &dx, &dy) == 2) {
+        if (t->n == m) {
+            m = m ? 2 * m : 1024;
+            t->d = realloc(t->d, m * sizeof(t->d[0]));
+        }
+
+        t->d[t->n][0] = dx;
+        t->d[t->n][1] = dy;
+        t->n += 1;
+    }
+
+    fclose(f);
+}
+
+static void step(struct pipeline *p, int16_t dx, int16_t dy)
+{
+    int16_t r[4];
+
+    p->update(dx, dy, false);
+    p->get(r, INT16_MAX);
+
+    for (int j = 0; j < 2; j++) {
+        const double a = r[j] - p->v[j];
+
+        p->jitter += a * a;
+        p->v[j] = r[j];
+        p->x[j] += r[j];
+
+        /* Count direction reversals, which is what's perceived as
+         * shimmer at low speeds. */
+
+        if (r[j] != 0) {
+            if ((r[j] > 0) != (p->last[j] > 0) && p->last[j] != 0) {
+                p->reversals += 1;
+            }
+
+            p->last[j] = r[j];
+        }
+    }
+}
+
+static void run(const struct trace *t)
+{
+    struct pipeline p[2] = {
+        {raw_update_axes, raw_get_axes, {0, 0}, {0, 0}, 0, {0, 0}, 0},
+        {smooth_update_axes, smooth_get_axes, {0, 0}, {0, 0}, 0, {0, 0}, 0}
+    };
+    double lag = 0, speed = 0;
+
+    for (int i = 0; i < t->n; i++) {
+        for (int k = 0; k < 2; k++) {
+            step(&p[k], t->d[i][0], t->d[i][1]);
+        }
+
+        lag += hypot(p[0].x[0] - p[1].x[0], p[0].x[1] - p[1].x[1]);
+        speed += hypot(p[0].v[0], p[0].v[1]);
+    }
+
+    /* Flush any motion still pending in the filter, so that it
+     * doesn't leak into the next trace. */
+
+    for (int i = 0; i < 2 * SMOOTHING_FRAMES; i++) {
+        for (int k = 0; k < 2; k++) {
+            step(&p[k], 0, 0);
+        }
+    }
+
+    const double a = sqrt(p[0].jitter / t->n), b = sqrt(p[1].jitter / t->n);
+
+    printf("%-24s %8.3f %8.3f %8d %8d", t->name, a, b,
+           p[0].reversals, p[1].reversals);
+
+    if (speed > 0) {
+        printf(" %8.2f\n", lag / speed);
+    } else {
+        printf(" %8s\n", "-");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    printf("Smoothing: %d frames, alpha %d/256, speed %d counts/frame "
+           "(delay bound %d frames)\n\n",
+           SMOOTHING_FRAMES, SMOOTHING_ALPHA, SMOOTHING_SPEED,
+           SMOOTHING_FRAMES - 1);
+
+    printf("%-24s %8s %8s %8s %8s %8s\n", "", "Jitter", "", "Reversals",
+           "", "Lag");
+    printf("%-24s %8s %8s %8s %8s %8s\n", "Sequence", "Raw", "Smoothed",
+           "Raw", "Smoothed", "(frames)");
+
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            struct trace t;
+
+            load(&t, argv[i]);
+            run(&t);
+            free(t.d);
+        }
+    } else {
+        const double speeds[] = {0, 0.5, 2, 8, 32, 128, 512};
+
+        srand(1);
+
+        for (size_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) {
+            char s[32];
+            struct trace t = {s, 0, NULL};
+
+            snprintf(s, sizeof(s), "%g counts/frame", speeds[i]);
+            synthesize(&t, speeds[i], SIGMA);
+            run(&t);
+            free(t.d);
+        }
+    }
+
+    return 0;
+}
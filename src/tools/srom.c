@@ -0,0 +1,186 @@
+/* Evaluate compressing the sensor SROM image.
+ *
+ * The image is packed with a small LZSS codec, of the kind that could
+ * be decoded byte by byte, within the 15 us gap between bytes of the
+ * SROM upload burst: a flag byte precedes each group of 8 items, each
+ * of which is either a literal byte, or a match of 3 to 18 bytes, at
+ * an offset of up to 4096 bytes back, coded in two bytes.  The packed
+ * image is unpacked again and compared with the original, and the
+ * order-0 entropy of the image is reported, along with the resulting
+ * savings.
+ *
+ * Usage: srom [FILE]
+ *
+ * FILE should be a C header containing the image as a list of hex
+ * bytes, as in ../srom_pmw3389.h, which is used by default. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define WINDOW 4096
+#define MINIMUM 3
+#define MAXIMUM (MINIMUM + 15)
+
+static int load(const char *path, uint8_t **b)
+{
+    FILE *f = fopen(path, "r");
+    int c, n = 0, m = 0;
+
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+
+    *b = NULL;
+
+    /* Skip everything up to the opening brace, then read all hex
+     * constants. */
+
+    while ((c = fgetc(f)) != EOF && c != '{');
+
+    while (!feof(f)) {
+        unsigned int x;
+
+        if (fscanf(f, " 0x%x", &x) == 1) {
+            if (n == m) {
+                m = m ? 2 * m : 4096;
+                *b = realloc(*b, m);
+            }
+
+            (*b)[n++] = x;
+        } else if (fgetc(f) == '}') {
+            break;
+        }
+    }
+
+    fclose(f);
+
+    return n;
+}
+
+static double entropy(const uint8_t *b, int n)
+{
+    int c[256] = {0};
+    double h = 0;
+
+    for (int i = 0; i < n; i++) {
+        c[b[i]] += 1;
+    }
+
+    for (int i = 0; i < 256; i++) {
+        if (c[i] > 0) {
+            const double p = (double)c[i] / n;
+
+            h -= p * log2(p);
+        }
+    }
+
+    return h;
+}
+
+static int pack(const uint8_t *b, int n, uint8_t *z)
+{
+    int i = 0, k = 0;
+
+    while (i < n) {
+        const int f = k++;
+
+        z[f] = 0;
+
+        for (int j = 0; j < 8 && i < n; j++) {
+            int l = 0, o = 0;
+
+            /* Find the longest match in the window. */
+
+            for (int s = (i > WINDOW ? i - WINDOW : 0); s < i; s++) {
+                int m = 0;
+
+                while (m < MAXIMUM && i + m < n && b[s + m] == b[i + m]) {
+                    m++;
+                }
+
+                if (m > l) {
+                    l = m;
+                    o = i - s;
+                }
+            }
+
+            if (l >= MINIMUM) {
+                z[f] |= (1 << j);
+                z[k++] = (o - 1) & 0xff;
+                z[k++] = ((o - 1) >> 8) << 4 | (l - MINIMUM);
+                i += l;
+            } else {
+                z[k++] = b[i++];
+            }
+        }
+    }
+
+    return k;
+}
+
+static int unpack(const uint8_t *z, int n, uint8_t *b)
+{
+    int i = 0, k = 0;
+
+    while (k < n) {
+        const uint8_t f = z[k++];
+
+        for (int j = 0; j < 8 && k < n; j++) {
+            if (f & (1 << j)) {
+                const int o = (z[k] | (z[k + 1] >> 4) << 8) + 1;
+                const int l = (z[k + 1] & 0xf) + MINIMUM;
+
+                for (int m = 0; m < l; m++, i++) {
+                    b[i] = b[i - o];
+                }
+
+                k += 2;
+            } else {
+                b[i++] = z[k++];
+            }
+        }
+    }
+
+    return i;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : "../srom_pmw3389.h";
+    uint8_t *b, *z, *u;
+    const int n = load(path, &b);
+
+    if (n == 0) {
+        fprintf(stderr, "%s: no image found\n", path);
+        return 1;
+    }
+
+    z = malloc(2 * n);
+    u = malloc(n + MAXIMUM);
+
+    const int m = pack(b, n, z);
+    const int l = unpack(z, m, u);
+
+    if (l != n || memcmp(b, u, n)) {
+        fprintf(stderr, "Round trip failed.\n");
+        return 1;
+    }
+
+    const double h = entropy(b, n);
+
+    printf("Image: %s, %d bytes\n", path, n);
+    printf("Entropy: %.3f bits/byte (order-0 bound %.0f bytes)\n",
+           h, ceil(h * n / 8));
+    printf("Packed: %d bytes, round trip OK, %+d bytes of flash saved\n",
+           m, n - m);
+
+    free(b);
+    free(z);
+    free(u);
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+/* Check that no motion is lost or wrapped around when the host stalls.
+ *
+ * If the host stops polling for a while, motion piles up in axes.c,
+ * which then reports as much of it as fits in each report, saturated
+ * to the range of the report fields, carrying the rest over to
+ * subsequent reports (see coalesce()).  This tool links a build of
+ * axes.c (see report_config.h) and feeds it fast pointer motion, one
+ * sensor frame at a time, at 16000 CPI, while the host stalls for
+ * hundreds of ms at a time, polling normally in between.  It then
+ * checks, for both report protocol and boot protocol limits:
+ *
+ * - That no report exceeds the range of the report fields, and that
+ *   reports do saturate, so that the carry is actually exercised.
+ *
+ * - That no report goes against the direction of motion, as it would
+ *   if the accumulated motion wrapped around.
+ *
+ * - That, once the motion stops and all of it has been reported, the
+ *   total reported on each axis is the total fed in, scaled by the
+ *   pointer sensitivity.
+ *
+ * Usage: stall
+ *
+ * The exit status is non-zero if any check fails. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "config.h"
+#include "check.h"
+
+#define CPI 16000
+#define STALLS 100
+#define FRAMES_PER_POLL (POLLING_INTERVAL * 1000 / SENSOR_INTERVAL)
+#define FRAMES_PER_MS (1000 / SENSOR_INTERVAL)
+
+/* The range of ball speeds, in inches per second, and stall lengths,
+ * in ms. */
+
+#define SPEED_MINIMUM 10
+#define SPEED_MAXIMUM 400
+#define STALL_MINIMUM 100
+#define STALL_MAXIMUM 800
+
+void report_update_axes(int16_t delta_x, int16_t delta_y, bool scroll);
+bool report_get_axes(int16_t *p, int16_t limit);
+
+static const double sensitivities[2] = {
+    POINTER_SENSITIVITY, -POINTER_SENSITIVITY
+};
+
+static long fed[2], reported[2], saturated, excessive, reversed;
+static int direction[2];
+
+/* Feed a sensor frame of motion of speed s, in inches per second, in
+ * the current direction. */
+
+static void feed(uint32_t s)
+{
+    const int16_t d = (int16_t)(s * CPI / (1000 * FRAMES_PER_MS));
+    const int16_t dx = direction[0] * d, dy = direction[1] * d;
+
+    report_update_axes(dx, dy, false);
+    fed[0] += dx;
+    fed[1] += dy;
+}
+
+/* Create and "send" a pointer report, as the HID class driver would,
+ * each polling interval. */
+
+static bool poll(int16_t limit)
+{
+    int16_t a[4];
+
+    report_get_axes(a, limit);
+
+    for (int i = 0; i < 2; i++) {
+        const int16_t x = a[i];
+        const bool forward = (direction[i] * sensitivities[i] > 0);
+
+        saturated += (abs(x) == limit);
+        excessive += (abs(x) > limit);
+        reversed += (x != 0 && (x > 0) != forward);
+        reported[i] += x;
+    }
+
+    return a[0] || a[1];
+}
+
+static bool run(const char *protocol, int16_t limit)
+{
+    char name[64];
+    bool ok = true;
+
+    fed[0] = fed[1] = reported[0] = reported[1] = 0;
+    saturated = excessive = reversed = 0;
+
+    for (uint32_t i = 0; i < STALLS; i++) {
+        const uint32_t s = (SPEED_MINIMUM
+                            + noise(i, 0, SPEED_MAXIMUM - SPEED_MINIMUM + 1));
+        const uint32_t n = (STALL_MINIMUM
+                            + noise(i, 1, STALL_MAXIMUM - STALL_MINIMUM + 1));
+
+        direction[0] = noise(i, 2, 2) ? 1 : -1;
+        direction[1] = noise(i, 3, 2) ? 1 : -1;
+
+        /* Stall for n ms, then poll normally for a second, while the
+         * ball keeps moving at the same speed. */
+
+        for (uint32_t j = 0; j < n * FRAMES_PER_MS; j++) {
+            feed(s);
+        }
+
+        for (uint32_t j = 0; j < 1000 * FRAMES_PER_MS; j++) {
+            feed(s);
+
+            if (j % FRAMES_PER_POLL == FRAMES_PER_POLL - 1) {
+                poll(limit);
+            }
+        }
+
+        /* Stop, and report whatever is still pending, until there's
+         * nothing left but fractions of a count. */
+
+        while (poll(limit));
+    }
+
+    snprintf(name, sizeof(name), "Saturated reports, %s", protocol);
+    ok &= check(name, saturated > 0, 1, 0);
+
+    snprintf(name, sizeof(name), "Reports out of range, %s", protocol);
+    ok &= check(name, excessive, 0, 0);
+
+    snprintf(name, sizeof(name), "Reports reversed, %s", protocol);
+    ok &= check(name, reversed, 0, 0);
+
+    for (int i = 0; i < 2; i++) {
+        snprintf(name, sizeof(name), "Motion along %c, %s", "XY"[i],
+                 protocol);
+        ok &= check(name, reported[i], lround(fed[i] * sensitivities[i]), 1);
+    }
+
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    bool ok = true;
+
+    check_header();
+
+    ok &= run("report protocol", INT16_MAX);
+    ok &= run("boot protocol", INT8_MAX);
+
+    if (!ok) {
+        fprintf(stderr, "Some checks failed.\n");
+        return 1;
+    }
+
+    return 0;
+}
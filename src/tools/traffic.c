@@ -0,0 +1,111 @@
+/* Measure the input reports an Orb sends, e.g. at rest, to check its
+ * idle rate handling, through Linux's hidraw interface.
+ *
+ * Usage: traffic DEVICE [SECONDS]
+ *
+ * DEVICE is the hidraw node of the mouse interface, e.g. /dev/hidraw3.
+ * Reports are read for SECONDS (10 by default), and the number of
+ * reports of each ID, their size and their rate are printed, along
+ * with the total.  The first byte of each report is taken as its ID,
+ * as the mouse interface always uses report IDs, in the report
+ * protocol.  The size includes the report ID byte, but not any
+ * of the USB protocol overhead.  Leave the Orb untouched while this
+ * runs, to measure the traffic at rest, which should be zero, unless
+ * the host has set an idle rate.
+ *
+ * Before idle rates were handled per report ID, with none by default,
+ * an Orb at rest sent two reports a second, to hosts that don't set
+ * an idle rate.  No measurement of either build on hardware has been
+ * recorded yet, so that comparison is still to be made. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+
+static double now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long reports[256] = {0}, bytes[256] = {0};
+    unsigned long total_reports = 0, total_bytes = 0;
+    double seconds = 10, start, t;
+    int fd;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s DEVICE [SECONDS]\n", argv[0]);
+        return 1;
+    }
+
+    if (argc > 2 && (seconds = atof(argv[2])) <= 0) {
+        fprintf(stderr, "%s: Invalid duration.\n", argv[2]);
+        return 1;
+    }
+
+    if ((fd = open(argv[1], O_RDONLY | O_NONBLOCK)) < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    /* Discard anything queued before we started. */
+
+    {
+        uint8_t r[64];
+
+        while (read(fd, r, sizeof(r)) > 0);
+    }
+
+    for (start = t = now(); t - start < seconds; t = now()) {
+        struct pollfd p = {.fd = fd, .events = POLLIN};
+        const int timeout = (int)((seconds - (t - start)) * 1000) + 1;
+        uint8_t r[64];
+        ssize_t n;
+
+        if (poll(&p, 1, timeout) < 0) {
+            perror("poll");
+            return 1;
+        }
+
+        if (!(p.revents & POLLIN)) {
+            continue;
+        }
+
+        if ((n = read(fd, r, sizeof(r))) < 0) {
+            perror(argv[1]);
+            return 1;
+        }
+
+        if (n > 0) {
+            reports[r[0]] += 1;
+            bytes[r[0]] += n;
+            total_reports += 1;
+            total_bytes += n;
+        }
+    }
+
+    close(fd);
+
+    printf("#id\treports\tbytes\treports/s\tbytes/s\n");
+
+    for (int i = 0; i < 256; i++) {
+        if (reports[i] > 0) {
+            printf("%d\t%lu\t%lu\t%.2f\t%.2f\n", i, reports[i], bytes[i],
+                   reports[i] / seconds, bytes[i] / seconds);
+        }
+    }
+
+    printf("total\t%lu\t%lu\t%.2f\t%.2f\n", total_reports, total_bytes,
+           total_reports / seconds, total_bytes / seconds);
+
+    return 0;
+}
@@ -0,0 +1,556 @@
+/* A virtual Orb, for testing the host's input pipeline without the
+ * hardware, through Linux's uhid interface.
+ *
+ * Usage: uhid [-r RATE] [FILE]
+ *
+ * A HID device is created with the mouse interface's report
+ * descriptor, as compiled into the firmware (see reports.h), and the
+ * kernel's handling of it is checked first:
+ *
+ * - The resolution multiplier should have been enabled, through a
+ *   SET_REPORT request for the feature report.
+ *
+ * - The wheel and AC pan should produce high-resolution REL_WHEEL_HI_RES
+ *   and REL_HWHEEL_HI_RES events, scaled according to the multiplier,
+ *   as well as the corresponding low-resolution events, for each
+ *   whole detent.
+ *
+ * Then motion is replayed, one pointer report per polling interval,
+ * at RATE Hz (1000 by default; the firmware's rate is set by
+ * POLLING_INTERVAL).  FILE should contain one "dx dy" pair of counts
+ * per line, as for the smoothing tool.  Without it, circular motion
+ * is synthesized.  For each report, the latency from writing it to
+ * uhid to the timestamp of the resulting evdev event, as well as to
+ * the point where it has been read back, is measured, and the
+ * distribution is printed at the end.  The total motion read back is
+ * also checked against what was sent.
+ *
+ * The evdev device is grabbed, so that the replayed motion doesn't
+ * move the pointer.  Access to /dev/uhid and /dev/input is needed,
+ * which usually means running as root. */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <math.h>
+#include <glob.h>
+#include <sys/ioctl.h>
+#include <linux/uhid.h>
+#include <linux/input.h>
+
+#include "reports_host.h"
+#include "check.h"
+
+#ifndef REL_WHEEL_HI_RES
+#error "Kernel headers with high-resolution wheel support (Linux 5.0) are needed."
+#endif
+
+#define TIMEOUT 5000
+#define FRAMES 5000
+
+static int uhid, evdev = -1;
+static char uniq[64];
+
+/* The feature report: the resolution multiplier in the low two bits of
+ * the first byte, followed by the resolution and the resolution switch
+ * latency, as the firmware reports them. */
+
+static uint8_t feature[6] = {
+    REPORT_ID_FEATURE, 0, RESOLUTION & 0xff, RESOLUTION >> 8
+};
+static bool multiplier_set;
+
+static void fail(const char *s)
+{
+    perror(s);
+    exit(1);
+}
+
+static double now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void put(const struct uhid_event *e)
+{
+    if (write(uhid, e, sizeof(*e)) != sizeof(*e)) {
+        fail("uhid");
+    }
+}
+
+/* Handle an event from uhid.  The kernel's GET_REPORT and SET_REPORT
+ * requests have to be answered, or it will time out, so this should
+ * be called whenever uhid is readable. */
+
+static void handle(void)
+{
+    struct uhid_event e, r;
+
+    if (read(uhid, &e, sizeof(e)) < 0) {
+        fail("uhid");
+    }
+
+    memset(&r, 0, sizeof(r));
+
+    switch (e.type) {
+    case UHID_GET_REPORT:
+        r.type = UHID_GET_REPORT_REPLY;
+        r.u.get_report_reply.id = e.u.get_report.id;
+
+        if (e.u.get_report.rnum == REPORT_ID_FEATURE
+            && e.u.get_report.rtype == UHID_FEATURE_REPORT) {
+            r.u.get_report_reply.size = sizeof(feature);
+            memcpy(r.u.get_report_reply.data, feature, sizeof(feature));
+        } else {
+            r.u.get_report_reply.err = EIO;
+        }
+
+        put(&r);
+        break;
+
+    case UHID_SET_REPORT:
+        r.type = UHID_SET_REPORT_REPLY;
+        r.u.set_report_reply.id = e.u.set_report.id;
+
+        /* Only the multiplier is writable. */
+
+        if (e.u.set_report.rnum == REPORT_ID_FEATURE
+            && e.u.set_report.rtype == UHID_FEATURE_REPORT
+            && e.u.set_report.size >= 2) {
+            feature[1] = e.u.set_report.data[1] & 0x03;
+            multiplier_set = true;
+        } else {
+            r.u.set_report_reply.err = EIO;
+        }
+
+        put(&r);
+        break;
+
+    default:
+        break;
+    }
+}
+
+/* Wait for up to t ms for evdev to become readable, handling uhid
+ * events meanwhile.  Returns false on timeout. */
+
+static bool wait(int t)
+{
+    const double deadline = now() + t * 1e-3;
+
+    for (;;) {
+        struct pollfd p[2] = {{uhid, POLLIN, 0}, {evdev, POLLIN, 0}};
+        const int dt = (deadline - now()) * 1e3;
+
+        if (dt < 0) {
+            return false;
+        }
+
+        if (poll(p, evdev < 0 ? 1 : 2, dt) < 0 && errno != EINTR) {
+            fail("poll");
+        }
+
+        if (p[0].revents & POLLIN) {
+            handle();
+        }
+
+        if (evdev >= 0 && (p[1].revents & POLLIN)) {
+            return true;
+        }
+    }
+}
+
+static void create(void)
+{
+    struct uhid_event e;
+
+    if ((uhid = open("/dev/uhid", O_RDWR | O_CLOEXEC)) < 0) {
+        fail("/dev/uhid");
+    }
+
+    memset(&e, 0, sizeof(e));
+    e.type = UHID_CREATE2;
+
+    snprintf(uniq, sizeof(uniq), "orb-uhid-%d", getpid());
+    strcpy((char *)e.u.create2.name, "Virtual Orb");
+    strcpy((char *)e.u.create2.uniq, uniq);
+
+    e.u.create2.rd_size = sizeof(MouseReport);
+    e.u.create2.bus = BUS_USB;
+    e.u.create2.vendor = VENDOR_ID;
+    e.u.create2.product = PRODUCT_ID;
+    memcpy(e.u.create2.rd_data, MouseReport, sizeof(MouseReport));
+
+    put(&e);
+}
+
+/* Find the evdev node of our device, by its unique id, and open it.
+ * The kernel creates it asynchronously, so keep looking, while
+ * handling uhid events, which it needs answered to get there. */
+
+static void find(void)
+{
+    const double deadline = now() + TIMEOUT * 1e-3;
+
+    while (now() < deadline) {
+        glob_t g;
+
+        if (glob("/sys/class/input/event*/device/uniq", 0, NULL, &g) == 0) {
+            for (size_t i = 0; i < g.gl_pathc && evdev < 0; i++) {
+                char s[64] = "", path[64];
+                FILE *f = fopen(g.gl_pathv[i], "r");
+
+                if (!f) {
+                    continue;
+                }
+
+                if (fgets(s, sizeof(s), f)) {
+                    s[strcspn(s, "\n")] = '\0';
+                }
+
+                fclose(f);
+
+                if (strcmp(s, uniq) != 0) {
+                    continue;
+                }
+
+                snprintf(path, sizeof(path), "/dev/input/%s",
+                         g.gl_pathv[i] + strlen("/sys/class/input/"));
+                *strchr(path + strlen("/dev/input/"), '/') = '\0';
+
+                if ((evdev = open(path, O_RDONLY | O_NONBLOCK)) < 0) {
+                    fail(path);
+                }
+
+                printf("Device: %s\n", path);
+            }
+
+            globfree(&g);
+        }
+
+        if (evdev >= 0) {
+            break;
+        }
+
+        wait(10);
+    }
+
+    if (evdev < 0) {
+        fprintf(stderr, "The input device didn't appear.\n");
+        exit(1);
+    }
+
+    const int clock = CLOCK_MONOTONIC;
+
+    if (ioctl(evdev, EVIOCSCLOCKID, &clock) < 0
+        || ioctl(evdev, EVIOCGRAB, 1) < 0) {
+        fail("evdev");
+    }
+}
+
+static void send(const uint8_t *r, size_t n)
+{
+    struct uhid_event e;
+
+    memset(&e, 0, sizeof(e));
+    e.type = UHID_INPUT2;
+    e.u.input2.size = n;
+    memcpy(e.u.input2.data, r, n);
+
+    put(&e);
+}
+
+/* Read the events of one report, up to SYN_REPORT, adding relative
+ * motion to sums, indexed by code.  Returns the timestamp of the
+ * SYN_REPORT event, or zero on timeout. */
+
+static double collect(long *sums)
+{
+    for (;;) {
+        struct input_event e;
+
+        if (read(evdev, &e, sizeof(e)) != sizeof(e)) {
+            if (errno != EAGAIN) {
+                fail("evdev");
+            }
+
+            if (!wait(TIMEOUT)) {
+                return 0;
+            }
+
+            continue;
+        }
+
+        if (e.type == EV_REL && e.code <= REL_MAX) {
+            sums[e.code] += e.value;
+        } else if (e.type == EV_SYN && e.code == SYN_REPORT) {
+            return e.input_event_sec + e.input_event_usec * 1e-6;
+        }
+    }
+}
+
+static void put16(uint8_t *p, int16_t x)
+{
+    p[0] = (uint16_t)x & 0xff;
+    p[1] = (uint16_t)x >> 8;
+}
+
+/* Check the kernel's handling of the descriptor. */
+
+static bool check_descriptor(void)
+{
+    const int16_t wheel[] = {30, 30, 30, 30, 60, 60};
+    const int16_t pan[] = {-40, -40, -40};
+    unsigned long bits[(REL_MAX + 8 * sizeof(long)) / (8 * sizeof(long))];
+    long sums[REL_MAX + 1] = {0}, w = 0, p = 0;
+    bool ok = true;
+
+    memset(bits, 0, sizeof(bits));
+
+    if (ioctl(evdev, EVIOCGBIT(EV_REL, sizeof(bits)), bits) < 0) {
+        fail("evdev");
+    }
+
+    putchar('\n');
+    check_header();
+
+#define HAS(c) ((bits[(c) / (8 * sizeof(long))]                        \
+                 >> ((c) % (8 * sizeof(long)))) & 1)
+
+    ok &= check("REL_X, REL_Y", HAS(REL_X) && HAS(REL_Y), 1, 0);
+    ok &= check("REL_WHEEL, REL_HWHEEL",
+                HAS(REL_WHEEL) && HAS(REL_HWHEEL), 1, 0);
+    ok &= check("REL_WHEEL_HI_RES, REL_HWHEEL_HI_RES",
+                HAS(REL_WHEEL_HI_RES) && HAS(REL_HWHEEL_HI_RES), 1, 0);
+
+#undef HAS
+
+    ok &= check("Resolution multiplier set", multiplier_set, 1, 0);
+    ok &= check("Resolution multiplier", feature[1], 1, 0);
+
+    /* With the multiplier enabled, each count is 1/120 of a detent,
+     * which is the unit of the high-resolution events, otherwise each
+     * count is a detent. */
+
+    const int scale = (feature[1] == 1 ? 1 : 120);
+
+    for (size_t i = 0; i < sizeof(wheel) / sizeof(wheel[0]); i++) {
+        uint8_t r[5] = {REPORT_ID_SCROLL};
+
+        put16(r + 3, wheel[i]);
+        send(r, sizeof(r));
+        ok &= (collect(sums) > 0);
+        w += wheel[i] * scale;
+    }
+
+    for (size_t i = 0; i < sizeof(pan) / sizeof(pan[0]); i++) {
+        uint8_t r[5] = {REPORT_ID_SCROLL};
+
+        put16(r + 1, pan[i]);
+        send(r, sizeof(r));
+        ok &= (collect(sums) > 0);
+        p += pan[i] * scale;
+    }
+
+    ok &= check("REL_WHEEL_HI_RES", sums[REL_WHEEL_HI_RES], w, 0);
+    ok &= check("REL_WHEEL", sums[REL_WHEEL], w / 120, 0);
+    ok &= check("REL_HWHEEL_HI_RES", sums[REL_HWHEEL_HI_RES], p, 0);
+    ok &= check("REL_HWHEEL", sums[REL_HWHEEL], p / 120, 0);
+
+    return ok;
+}
+
+static int load(const char *path, int16_t (**d)[2])
+{
+    FILE *f = fopen(path, "r");
+    int dx, dy, n = 0, m = 0;
+
+    if (!f) {
+        fail(path);
+    }
+
+    *d = NULL;
+
+    while (fscanf(f, "%d %d", &dx, &dy) == 2) {
+        if (n == m) {
+            m = m ? 2 * m : 1024;
+            *d = realloc(*d, m * sizeof((*d)[0]));
+        }
+
+        (*d)[n][0] = dx < INT16_MIN ? INT16_MIN : dx > INT16_MAX ? INT16_MAX : dx;
+        (*d)[n][1] = dy < INT16_MIN ? INT16_MIN : dy > INT16_MAX ? INT16_MAX : dy;
+        n += 1;
+    }
+
+    fclose(f);
+
+    return n;
+}
+
+/* Circular motion, one revolution per second, at 40 counts per
+ * report. */
+
+static int synthesize(int rate, int16_t (**d)[2])
+{
+    *d = malloc(FRAMES * sizeof((*d)[0]));
+
+    for (int i = 0; i < FRAMES; i++) {
+        const double a = 2 * M_PI * i / rate;
+
+        (*d)[i][0] = lround(40 * cos(a));
+        (*d)[i][1] = lround(40 * sin(a));
+    }
+
+    return FRAMES;
+}
+
+static int compare(const void *a, const void *b)
+{
+    const double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void print_latency(const char *name, double *l, int n)
+{
+    double s = 0;
+
+    qsort(l, n, sizeof(l[0]), compare);
+
+    for (int i = 0; i < n; i++) {
+        s += l[i];
+    }
+
+    printf("%-24s %8.1f %8.1f %8.1f %8.1f %8.1f\n", name,
+           l[0] * 1e6, s / n * 1e6, l[n / 2] * 1e6, l[n * 99 / 100] * 1e6,
+           l[n - 1] * 1e6);
+}
+
+/* Replay motion, measuring the latency of each report. */
+
+static bool replay(int16_t (*d)[2], int n, int rate)
+{
+    double *event = malloc(n * sizeof(double));
+    double *reader = malloc(n * sizeof(double));
+    long sums[REL_MAX + 1] = {0}, x = 0, y = 0;
+    int k = 0, late = 0;
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    for (int i = 0; i < n; i++) {
+        /* Wait for the next polling interval. */
+
+        t.tv_nsec += 1000000000L / rate;
+
+        if (t.tv_nsec >= 1000000000L) {
+            t.tv_sec += 1;
+            t.tv_nsec -= 1000000000L;
+        }
+
+        if (now() > t.tv_sec + t.tv_nsec * 1e-9) {
+            late += 1;
+        } else {
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL);
+        }
+
+        /* Reports without motion aren't sent, by the firmware. */
+
+        if (!d[i][0] && !d[i][1]) {
+            continue;
+        }
+
+        uint8_t r[6] = {REPORT_ID_POINTER, 0};
+
+        put16(r + 2, d[i][0]);
+        put16(r + 4, d[i][1]);
+
+        const double t_0 = now();
+
+        send(r, sizeof(r));
+
+        const double t_1 = collect(sums);
+
+        if (t_1 == 0) {
+            fprintf(stderr, "No events for report %d.\n", i);
+            return false;
+        }
+
+        event[k] = t_1 - t_0;
+        reader[k] = now() - t_0;
+        k += 1;
+
+        x += d[i][0];
+        y += d[i][1];
+    }
+
+    printf("\nReplayed %d reports at %d Hz, %d late.\n\n", k, rate, late);
+
+    if (k > 0) {
+        printf("%-24s %8s %8s %8s %8s %8s\n", "Latency (us)",
+               "Minimum", "Mean", "Median", "99th", "Maximum");
+        print_latency("uhid write to event", event, k);
+        print_latency("uhid write to read", reader, k);
+    }
+
+    putchar('\n');
+    check_header();
+
+    bool ok = check("REL_X", sums[REL_X], x, 0);
+    ok &= check("REL_Y", sums[REL_Y], y, 0);
+
+    free(event);
+    free(reader);
+
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    int16_t (*d)[2];
+    int c, n, rate = 1000;
+
+    while ((c = getopt(argc, argv, "r:")) != -1) {
+        switch (c) {
+        case 'r':
+            rate = atoi(optarg);
+            break;
+
+        default:
+            rate = 0;
+        }
+    }
+
+    if (rate <= 0 || argc - optind > 1) {
+        fprintf(stderr, "Usage: %s [-r RATE] [FILE]\n", argv[0]);
+        return 1;
+    }
+
+    n = (optind < argc ? load(argv[optind], &d) : synthesize(rate, &d));
+
+    create();
+    find();
+
+    bool ok = check_descriptor();
+    ok &= replay(d, n, rate);
+
+    struct uhid_event e = {.type = UHID_DESTROY};
+
+    put(&e);
+    free(d);
+
+    return !ok;
+}
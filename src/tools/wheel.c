@@ -0,0 +1,277 @@
+/* Check the wheel's transfer function in axes.c on the host.
+ *
+ * The axes code is compiled twice (see wheel_config.h): with wheel
+ * acceleration, using the configured table, or a default one, and
+ * with emulated detents.  Scroll motion is fed through both, one
+ * polling interval (frame) at a time, and the following are checked:
+ *
+ * - The gain at a range of constant speeds, against the table, in
+ *   1/256ths.
+ *
+ * - That hosts that haven't enabled the resolution multiplier get the
+ *   same motion, in whole notches, and that motion handed back with
+ *   unget_axes(), or left short of a notch when the host enables the
+ *   multiplier, isn't lost.
+ *
+ * - That, with detents, the wheel clicks over to the next notch when
+ *   it's WHEEL_DETENT_HYSTERESIS counts past the midpoint, in either
+ *   direction, and not when jittering just short of that, and that it
+ *   only ever reports whole notches.
+ *
+ * Usage: wheel
+ *
+ * The exit status is non-zero if any check fails. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "check.h"
+
+#define NOTCH 120
+#define FRAMES 1000
+
+void accel_update_axes(int16_t delta_x, int16_t delta_y, bool scroll);
+bool accel_get_axes(int16_t *p, int16_t limit);
+void accel_unget_axes(const int16_t *p);
+void accel_set_wheel_multiplier(uint8_t m);
+void detent_update_axes(int16_t delta_x, int16_t delta_y, bool scroll);
+bool detent_get_axes(int16_t *p, int16_t limit);
+void detent_set_wheel_multiplier(uint8_t m);
+
+static const uint16_t curve[][2] = {WHEEL_ACCELERATION};
+
+#define CURVE_POINTS (sizeof(curve) / sizeof(curve[0]))
+
+/* The gain at speed s, interpolated from the table, in floating
+ * point. */
+
+static double gain(double s)
+{
+    if (s <= curve[0][0]) {
+        return curve[0][1];
+    }
+
+    for (unsigned int i = 1; i < CURVE_POINTS; i++) {
+        if (s < curve[i][0]) {
+            const double f = ((s - curve[i - 1][0])
+                              / (curve[i][0] - curve[i - 1][0]));
+
+            return curve[i - 1][1] + f * (curve[i][1] - curve[i - 1][1]);
+        }
+    }
+
+    return curve[CURVE_POINTS - 1][1];
+}
+
+/* Feed n frames of vertical scroll motion of d counts each through a
+ * pipeline, and return the total reported. */
+
+static long feed(void (*update)(int16_t, int16_t, bool),
+                 bool (*get)(int16_t *, int16_t), int16_t d, int n)
+{
+    long total = 0;
+
+    for (int i = 0; i < n; i++) {
+        int16_t p[4];
+
+        update(0, d, true);
+        get(p, INT16_MAX);
+        total += p[3];
+    }
+
+    return total;
+}
+
+static long feed_accel(int16_t d, int n)
+{
+    return feed(accel_update_axes, accel_get_axes, d, n);
+}
+
+static long feed_detent(int16_t d, int n)
+{
+    return feed(detent_update_axes, detent_get_axes, d, n);
+}
+
+/* Pseudo-random scroll motion for frame i, with bursts of varying
+ * speed, the same every time. */
+
+static int16_t motion(int i)
+{
+    uint32_t x = (uint32_t)i * 2654435761u;
+
+    x ^= x >> 15;
+    x *= 2246822519u;
+    x ^= x >> 13;
+
+    return (int16_t)((i / 100 % 2 ? 1 : -1) * (x % (i % 100 + 1)));
+}
+
+static bool check_acceleration(void)
+{
+    const int16_t speeds[] = {1, 2, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96,
+                              128, 256};
+    bool ok = true;
+    char name[64];
+
+    accel_set_wheel_multiplier(1);
+
+    for (unsigned int i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) {
+        const int16_t s = speeds[i];
+        const long expected = lround(gain(s));
+
+        /* Let the speed estimate settle first. */
+
+        feed_accel(s, 50);
+
+        snprintf(name, sizeof(name), "Gain at %d counts per frame", s);
+        ok &= check(name, lround(feed_accel(s, FRAMES) * 256.0 / s / FRAMES),
+                    expected, 2 + expected / 100);
+    }
+
+    feed_accel(-32, 50);
+    ok &= check("Gain in reverse",
+                lround(feed_accel(-32, FRAMES) * 256.0 / -32 / FRAMES),
+                lround(gain(32)), 2 + lround(gain(32)) / 100);
+
+    return ok;
+}
+
+static bool check_multiplier(void)
+{
+    long hires = 0, notches = 0, ungot = 0;
+    int16_t p[4], q[4];
+    bool ok = true;
+
+    /* Feed the same motion with and without the multiplier, letting
+     * the motion settle in between. */
+
+    accel_set_wheel_multiplier(1);
+    feed_accel(0, 50);
+
+    for (int i = 0; i < 10 * FRAMES; i++) {
+        hires += feed_accel(motion(i), 1);
+    }
+
+    hires += feed_accel(0, 50);
+
+    accel_set_wheel_multiplier(0);
+
+    for (int i = 0; i < 10 * FRAMES; i++) {
+        notches += feed_accel(motion(i), 1);
+    }
+
+    notches += feed_accel(0, 50);
+
+    ok &= check("Motion without the multiplier", notches * NOTCH, hires,
+                NOTCH);
+
+    /* Motion handed back should be reported again as is. */
+
+    for (uint8_t m = 0; m < 2; m++) {
+        accel_set_wheel_multiplier(m);
+        accel_update_axes(0, 1000, true);
+        accel_get_axes(p, INT16_MAX);
+        accel_unget_axes(p);
+        accel_get_axes(q, INT16_MAX);
+
+        ungot += (p[3] == q[3] && p[3] != 0);
+    }
+
+    ok &= check("Motion handed back", ungot, 2, 0);
+
+    /* Motion short of a notch, when the multiplier is enabled, should
+     * be reported in high-resolution counts, rather than lost. */
+
+    for (uint8_t m = 0; m < 2; m++) {
+        long *total = m ? &hires : &notches;
+
+        accel_set_wheel_multiplier(1);
+        feed_accel(0, 50);
+        accel_set_wheel_multiplier(m);
+        *total = feed_accel(NOTCH / 4, 1) * (m ? 1 : NOTCH);
+        accel_set_wheel_multiplier(1);
+        *total += feed_accel(0, 50);
+    }
+
+    ok &= check("Motion kept when enabling the multiplier", notches,
+                hires, 1);
+
+    return ok;
+}
+
+static bool check_detents(void)
+{
+    const int t = NOTCH / 2 + WHEEL_DETENT_HYSTERESIS;
+    const int b = 2 * WHEEL_DETENT_HYSTERESIS;
+    long n = 0, d = 0, whole = 0, total = 0;
+    bool ok = true;
+
+    detent_set_wheel_multiplier(1);
+
+    /* Move forward a count at a time, up to the first click. */
+
+    for (n = 1; n <= NOTCH && feed_detent(1, 1) == 0; n++);
+
+    ok &= check("Counts to the first notch", n, t, 0);
+
+    /* Jitter back and forth, just short of clicking back. */
+
+    for (int i = 0; i < FRAMES; i++) {
+        d += labs(feed_detent(i % 2 ? b - 1 : -(b - 1), 1));
+    }
+
+    ok &= check("Notches while jittering", d, 0, 0);
+
+    /* Move back to the previous notch. */
+
+    ok &= check("Counts back, short of the notch",
+                feed_detent(-(b - 1), 1), 0, 0);
+    ok &= check("Motion back to the previous notch",
+                feed_detent(-1, 1), -NOTCH, 0);
+
+    /* Arbitrary motion should always be reported in whole notches,
+     * and add up. */
+
+    for (int i = 0; i < 10 * FRAMES; i++) {
+        const int16_t m = motion(i);
+        const long r = feed_detent(m, 1);
+
+        whole += (r % NOTCH == 0);
+        total += r - m;
+    }
+
+    ok &= check("Reports of whole notches", whole, 10 * FRAMES, 0);
+    ok &= check("Motion lost or gained", total, 0, t);
+
+    /* Without the multiplier, each notch is a single count. */
+
+    detent_set_wheel_multiplier(0);
+    feed_detent(0, 1);
+
+    for (n = 1; n <= NOTCH && (d = feed_detent(1, 1)) == 0; n++);
+
+    ok &= check("Notch without the multiplier", d, 1, 0);
+
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    bool ok = true;
+
+    check_header();
+
+    ok &= check_acceleration();
+    ok &= check_multiplier();
+    ok &= check_detents();
+
+    if (!ok) {
+        fprintf(stderr, "Some checks failed.\n");
+        return 1;
+    }
+
+    return 0;
+}
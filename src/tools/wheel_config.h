@@ -0,0 +1,31 @@
+/* Configuration overrides for the wheel tool's builds of axes.c.  Like
+ * axes_config.h, this header is force-included ahead of axes.c.
+ *
+ * Wheel motion is reported in sensor counts, scaled only by the
+ * acceleration gain, so that the gain can be measured directly.  The
+ * configured acceleration table is used, or a reasonable default, if
+ * acceleration isn't enabled.  With DETENTS, detents are emulated
+ * instead, without acceleration, so that the hysteresis can be
+ * checked count by count. */
+
+#include "config.h"
+
+#undef WHEEL_SENSITIVITY_X
+#undef WHEEL_SENSITIVITY_Y
+
+#define WHEEL_SENSITIVITY_X 1
+#define WHEEL_SENSITIVITY_Y 1
+
+/* Twist isn't simulated. */
+
+#undef TWIST_SENSOR_SS
+
+#ifdef DETENTS
+#undef WHEEL_ACCELERATION
+#define WHEEL_DETENTS
+#else
+#undef WHEEL_DETENTS
+#ifndef WHEEL_ACCELERATION
+#define WHEEL_ACCELERATION {0, 192}, {8, 256}, {32, 640}, {96, 1536}
+#endif
+#endif
@@ -7,11 +7,16 @@
 #include <avr/pgmspace.h>
 #include <avr/power.h>
 #include <avr/wdt.h>
+#include <util/atomic.h>
 
 #include <LUFA/Drivers/USB/USB.h>
 #include <LUFA/Platform/Platform.h>
 
 #include "config.h"
+#include "profile.h"
+#include "memory.h"
+#include "telemetry.h"
+#include "reports.h"
 
 #ifdef ENABLE_CDC
 #define CDC_NOTIFICATION_EPADDR (ENDPOINT_DIR_IN | 2)
@@ -22,7 +27,16 @@
 #endif
 
 #define MOUSE_EPADDR (ENDPOINT_DIR_IN | 1)
-#define MOUSE_EPSIZE 8
+
+#ifdef KEY_MAP
+#define KEYBOARD_EPADDR (ENDPOINT_DIR_IN | 6)
+#define KEYBOARD_EPSIZE 8
+#endif
+
+#ifdef ENABLE_TELEMETRY
+#define TELEMETRY_EPADDR (ENDPOINT_DIR_IN | 5)
+#define TELEMETRY_EPSIZE 32
+#endif
 
 enum
 {
@@ -32,6 +46,16 @@ enum
 #endif
 
     INTERFACE_ID_Mouse,
+
+#ifdef KEY_MAP
+    INTERFACE_ID_Keyboard,
+#endif
+
+#ifdef ENABLE_TELEMETRY
+    INTERFACE_ID_Telemetry,
+#endif
+
+    INTERFACE_COUNT
 };
 
 enum
@@ -67,16 +91,23 @@ typedef struct
     USB_Descriptor_Interface_t HID_Interface;
     USB_HID_Descriptor_HID_t HID_MouseHID;
     USB_Descriptor_Endpoint_t HID_ReportINEndpoint;
-} USB_Descriptor_Configuration_t;
 
-typedef struct {
-    uint8_t buttons;
-    int16_t axes[4];
-} MouseReport_Data_t;
+#ifdef KEY_MAP
+    /* Keyboard HID Interface */
+
+    USB_Descriptor_Interface_t Keyboard_Interface;
+    USB_HID_Descriptor_HID_t Keyboard_HID;
+    USB_Descriptor_Endpoint_t Keyboard_ReportINEndpoint;
+#endif
 
-typedef struct {
-    uint8_t multiplier;
-} FeatureReport_Data_t;
+#ifdef ENABLE_TELEMETRY
+    /* Telemetry HID Interface */
+
+    USB_Descriptor_Interface_t Telemetry_Interface;
+    USB_HID_Descriptor_HID_t Telemetry_HID;
+    USB_Descriptor_Endpoint_t Telemetry_ReportINEndpoint;
+#endif
+} USB_Descriptor_Configuration_t;
 
 void EVENT_USB_Device_Connect(void);
 void EVENT_USB_Device_Disconnect(void);
@@ -103,73 +134,32 @@ uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
                                     const void** const DescriptorAddress)
     ATTR_WARN_UNUSED_RESULT ATTR_NON_NULL_PTR_ARG(3);
 
-#define BUTTON_COUNT sizeof((uint8_t[]){BUTTONS})
+/* The mouse interface's report descriptor, MouseReport, and the
+ * layout of its reports are in reports.h, so that host-side tools can
+ * share them. */
+
+#ifdef KEY_MAP
+const USB_Descriptor_HIDReport_Datatype_t PROGMEM KeyboardReport[] = {
+    HID_DESCRIPTOR_KEYBOARD(6)
+};
+#endif
 
-const USB_Descriptor_HIDReport_Datatype_t PROGMEM MouseReport[] = {
-    HID_RI_USAGE_PAGE(8, 0x01), /* Generic Desktop */
-    HID_RI_USAGE(8, 0x02), /* Mouse */
+#ifdef ENABLE_TELEMETRY
+/* The telemetry report is opaque to the host (see telemetry.h). */
+
+const USB_Descriptor_HIDReport_Datatype_t PROGMEM TelemetryReport[] = {
+    HID_RI_USAGE_PAGE(16, 0xff00), /* Vendor defined */
+    HID_RI_USAGE(8, 0x03), /* Telemetry */
     HID_RI_COLLECTION(8, 0x01), /* Application */
-    HID_RI_USAGE(8, 0x01), /* Pointer */
-    HID_RI_COLLECTION(8, 0x00), /* Physical */
-    HID_RI_USAGE_PAGE(8, 0x09), /* Button */
-    HID_RI_USAGE_MINIMUM(8, 0x01),
-    HID_RI_USAGE_MAXIMUM(8, BUTTON_COUNT),
-    HID_RI_LOGICAL_MINIMUM(8, 0x00),
-    HID_RI_LOGICAL_MAXIMUM(8, 0x01),
-    HID_RI_REPORT_COUNT(8, BUTTON_COUNT),
-    HID_RI_REPORT_SIZE(8, 0x01),
-    HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-    HID_RI_REPORT_COUNT(8, 0x01),
-    HID_RI_REPORT_SIZE(8, 8 - (BUTTON_COUNT % 8)),
-    HID_RI_INPUT(8, HID_IOF_CONSTANT),
-
-    HID_RI_USAGE_PAGE(8, 0x01), /* Generic Desktop */
-    HID_RI_USAGE(8, 0x30), /* Usage X */
-    HID_RI_USAGE(8, 0x31), /* Usage Y */
-    HID_RI_LOGICAL_MINIMUM(16, -32768),
-    HID_RI_LOGICAL_MAXIMUM(16, 32767),
-    HID_RI_PHYSICAL_MINIMUM(8, -1),
-    HID_RI_PHYSICAL_MAXIMUM(8, 1),
-    HID_RI_REPORT_COUNT(8, 0x02),
-    HID_RI_REPORT_SIZE(8, 16),
-    HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_RELATIVE),
-
-    HID_RI_COLLECTION(8, 0x02), /* Logical */
-    HID_RI_USAGE(8, 0x48), /* Resolution Multiplier */
+    HID_RI_USAGE(8, 0x04), /* Telemetry report */
     HID_RI_LOGICAL_MINIMUM(8, 0x00),
-    HID_RI_LOGICAL_MAXIMUM(8, 0x01),
-    HID_RI_PHYSICAL_MINIMUM(8, 0x01),
-    HID_RI_PHYSICAL_MAXIMUM(8, 120),
-    HID_RI_REPORT_COUNT(8, 0x01),
-    HID_RI_REPORT_SIZE(8, 0x02),
-    HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-
-    HID_RI_USAGE_PAGE(8, 0x0c), /* Consumer devices */
-    HID_RI_USAGE(16, 0x0238), /* AC pan */
-    HID_RI_LOGICAL_MINIMUM(16, -32768),
-    HID_RI_LOGICAL_MAXIMUM(16, 32767),
-    HID_RI_PHYSICAL_MINIMUM(8, 0),
-    HID_RI_PHYSICAL_MAXIMUM(8, 0),
-    HID_RI_REPORT_SIZE(8, 16),
-    HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_RELATIVE),
-
-    HID_RI_USAGE_PAGE(8, 0x01), /* Generic Desktop */
-    HID_RI_USAGE(8, 0x38), /* Wheel */
-    HID_RI_LOGICAL_MINIMUM(16, -32768),
-    HID_RI_LOGICAL_MAXIMUM(16, 32767),
-    HID_RI_PHYSICAL_MINIMUM(8, 0),
-    HID_RI_PHYSICAL_MAXIMUM(8, 0),
-    HID_RI_REPORT_SIZE(8, 16),
-    HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_RELATIVE),
-    HID_RI_END_COLLECTION(0),
-
-    HID_RI_REPORT_COUNT(8, 0x01),
-    HID_RI_REPORT_SIZE(8, 0x06),
-    HID_RI_FEATURE(8, HID_IOF_CONSTANT | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-
-    HID_RI_END_COLLECTION(0),
+    HID_RI_LOGICAL_MAXIMUM(16, 0xff),
+    HID_RI_REPORT_COUNT(8, sizeof(struct telemetry)),
+    HID_RI_REPORT_SIZE(8, 8),
+    HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_ARRAY | HID_IOF_ABSOLUTE),
     HID_RI_END_COLLECTION(0)
 };
+#endif
 
 const USB_Descriptor_Device_t PROGMEM DeviceDescriptor = {
     .Header = {.Size = sizeof(USB_Descriptor_Device_t), .Type = DTYPE_Device},
@@ -206,11 +196,7 @@ const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor = {
             .Type = DTYPE_Configuration},
 
         .TotalConfigurationSize = sizeof(USB_Descriptor_Configuration_t),
-#ifdef ENABLE_CDC
-        .TotalInterfaces = 3,
-#else
-        .TotalInterfaces = 1,
-#endif
+        .TotalInterfaces = INTERFACE_COUNT,
 
         .ConfigurationNumber = 1,
         .ConfigurationStrIndex = NO_DESCRIPTOR,
@@ -395,7 +381,101 @@ const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor = {
                        | ENDPOINT_USAGE_DATA),
         .EndpointSize = MOUSE_EPSIZE,
         .PollingIntervalMS = POLLING_INTERVAL
-    }
+    },
+
+#ifdef KEY_MAP
+    .Keyboard_Interface =
+    {
+        .Header = {
+            .Size = sizeof(USB_Descriptor_Interface_t),
+            .Type = DTYPE_Interface},
+
+        .InterfaceNumber = INTERFACE_ID_Keyboard,
+        .AlternateSetting = 0x00,
+
+        .TotalEndpoints = 1,
+
+        .Class = HID_CSCP_HIDClass,
+        .SubClass = HID_CSCP_BootSubclass,
+        .Protocol = HID_CSCP_KeyboardBootProtocol,
+
+        .InterfaceStrIndex = NO_DESCRIPTOR
+    },
+
+    .Keyboard_HID =
+    {
+        .Header = {
+            .Size = sizeof(USB_HID_Descriptor_HID_t),
+            .Type = HID_DTYPE_HID},
+
+        .HIDSpec = VERSION_BCD(1,1,1),
+        .CountryCode = 0x00,
+        .TotalReportDescriptors = 1,
+        .HIDReportType = HID_DTYPE_Report,
+        .HIDReportLength = sizeof(KeyboardReport)
+    },
+
+    .Keyboard_ReportINEndpoint =
+    {
+        .Header = {
+            .Size = sizeof(USB_Descriptor_Endpoint_t),
+            .Type = DTYPE_Endpoint},
+
+        .EndpointAddress = KEYBOARD_EPADDR,
+        .Attributes = (EP_TYPE_INTERRUPT
+                       | ENDPOINT_ATTR_NO_SYNC
+                       | ENDPOINT_USAGE_DATA),
+        .EndpointSize = KEYBOARD_EPSIZE,
+        .PollingIntervalMS = POLLING_INTERVAL
+    },
+#endif
+
+#ifdef ENABLE_TELEMETRY
+    .Telemetry_Interface =
+    {
+        .Header = {
+            .Size = sizeof(USB_Descriptor_Interface_t),
+            .Type = DTYPE_Interface},
+
+        .InterfaceNumber = INTERFACE_ID_Telemetry,
+        .AlternateSetting = 0x00,
+
+        .TotalEndpoints = 1,
+
+        .Class = HID_CSCP_HIDClass,
+        .SubClass = HID_CSCP_NonBootSubclass,
+        .Protocol = HID_CSCP_NonBootProtocol,
+
+        .InterfaceStrIndex = NO_DESCRIPTOR
+    },
+
+    .Telemetry_HID =
+    {
+        .Header = {
+            .Size = sizeof(USB_HID_Descriptor_HID_t),
+            .Type = HID_DTYPE_HID},
+
+        .HIDSpec = VERSION_BCD(1,1,1),
+        .CountryCode = 0x00,
+        .TotalReportDescriptors = 1,
+        .HIDReportType = HID_DTYPE_Report,
+        .HIDReportLength = sizeof(TelemetryReport)
+    },
+
+    .Telemetry_ReportINEndpoint =
+    {
+        .Header = {
+            .Size = sizeof(USB_Descriptor_Endpoint_t),
+            .Type = DTYPE_Endpoint},
+
+        .EndpointAddress = TELEMETRY_EPADDR,
+        .Attributes = (EP_TYPE_INTERRUPT
+                       | ENDPOINT_ATTR_NO_SYNC
+                       | ENDPOINT_USAGE_DATA),
+        .EndpointSize = TELEMETRY_EPSIZE,
+        .PollingIntervalMS = 1
+    },
+#endif
 };
 
 const USB_Descriptor_String_t PROGMEM LanguageString =
@@ -441,11 +521,41 @@ uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
                     return NO_DESCRIPTOR;
                 }
 
+        /* The HID class descriptors are requested per interface. */
+
         case HID_DTYPE_HID:
+#ifdef KEY_MAP
+            if (wIndex == INTERFACE_ID_Keyboard) {
+                *DescriptorAddress = &ConfigurationDescriptor.Keyboard_HID;
+                return sizeof(USB_HID_Descriptor_HID_t);
+            }
+#endif
+
+#ifdef ENABLE_TELEMETRY
+            if (wIndex == INTERFACE_ID_Telemetry) {
+                *DescriptorAddress = &ConfigurationDescriptor.Telemetry_HID;
+                return sizeof(USB_HID_Descriptor_HID_t);
+            }
+#endif
+
             *DescriptorAddress = &ConfigurationDescriptor.HID_MouseHID;
             return sizeof(USB_HID_Descriptor_HID_t);
 
         case HID_DTYPE_Report:
+#ifdef KEY_MAP
+            if (wIndex == INTERFACE_ID_Keyboard) {
+                *DescriptorAddress = &KeyboardReport;
+                return sizeof(KeyboardReport);
+            }
+#endif
+
+#ifdef ENABLE_TELEMETRY
+            if (wIndex == INTERFACE_ID_Telemetry) {
+                *DescriptorAddress = &TelemetryReport;
+                return sizeof(TelemetryReport);
+            }
+#endif
+
             *DescriptorAddress = &MouseReport;
             return sizeof(MouseReport);
 
@@ -481,6 +591,17 @@ USB_ClassInfo_CDC_Device_t CDC_Interface = {
 };
 #endif
 
+/* Any of the mouse interface's reports, of any type, which sizes the
+ * buffer the class driver has them created in. */
+
+typedef union {
+    PointerReport_Data_t pointer;
+    ScrollReport_Data_t scroll;
+    BootReport_Data_t boot;
+    FeatureReport_Data_t feature;
+    BootloaderReport_Data_t bootloader;
+} MouseReport_Data_t;
+
 USB_ClassInfo_HID_Device_t HID_Interface = {
     .Config =
     {
@@ -496,14 +617,233 @@ USB_ClassInfo_HID_Device_t HID_Interface = {
     },
 };
 
+#ifdef KEY_MAP
+static uint8_t PrevKeyboardReport[sizeof(USB_KeyboardReport_Data_t)];
+
+USB_ClassInfo_HID_Device_t Keyboard_Interface = {
+    .Config =
+    {
+        .InterfaceNumber = INTERFACE_ID_Keyboard,
+        .ReportINEndpoint =
+        {
+            .Address = KEYBOARD_EPADDR,
+            .Size = KEYBOARD_EPSIZE,
+            .Banks = 1,
+        },
+
+        /* Let the class driver detect changes in the key state. */
+
+        .PrevReportINBuffer = PrevKeyboardReport,
+        .PrevReportINBufferSize = sizeof(PrevKeyboardReport),
+    },
+};
+#endif
+
+#ifdef ENABLE_TELEMETRY
+USB_ClassInfo_HID_Device_t Telemetry_Interface = {
+    .Config =
+    {
+        .InterfaceNumber = INTERFACE_ID_Telemetry,
+        .ReportINEndpoint =
+        {
+            .Address = TELEMETRY_EPADDR,
+            .Size = TELEMETRY_EPSIZE,
+            .Banks = 1,
+        },
+        .PrevReportINBuffer = NULL,
+        .PrevReportINBufferSize = sizeof(struct telemetry),
+    },
+};
+#endif
+
+#ifdef ENABLE_BOOTLOADER_JUMP
+/* Jump to the bootloader.  Rather than handing it the application's
+ * state, the USB controller's in particular, the device is detached
+ * and reset through the watchdog, leaving a key in RAM that isn't
+ * initialized at startup.  The key is checked early in the startup
+ * code, before anything else has been touched, and the bootloader
+ * entered with the MCU in its reset state. */
+
+#define BOOT_KEY_MAGIC 0xdc42acca
+
+static uint32_t boot_key ATTR_NO_INIT;
+static volatile bool jump_requested;
+
+void check_bootloader_jump(void) ATTR_INIT_SECTION(3);
+
+void check_bootloader_jump(void)
+{
+    /* The watchdog stays enabled after it has reset the MCU, so it
+     * has to be disabled in any case. */
+
+    if (MCUSR & (1 << WDRF)) {
+        MCUSR &= ~(1 << WDRF);
+        wdt_disable();
+
+        if (boot_key == BOOT_KEY_MAGIC) {
+            boot_key = 0;
+            ((void (*)(void))((FLASHEND + 1UL - BOOTLOADER_SIZE) / 2))();
+        }
+    }
+}
+
+static void jump_to_bootloader(void)
+{
+    /* Detach, and give the host time to notice, before the bootloader
+     * attaches again. */
+
+    USB_Disable();
+    cli();
+    Delay_MS(250);
+
+    boot_key = BOOT_KEY_MAGIC;
+    wdt_enable(WDTO_15MS);
+
+    for (;;);
+}
+#endif
+
+/* Idle rates of the mouse's input reports, as set by the host with
+ * SET_IDLE, in units of 4 ms.  LUFA's class driver keeps a single rate
+ * for the whole interface, whatever the report ID in the request, and
+ * defaults it to 500 ms, so that an unchanged report is sent twice a
+ * second, even at rest.  The requests are therefore handled here, per
+ * report ID, and the driver's own rate is kept at zero.  A rate of
+ * zero means that a report is only sent when it changes, which is
+ * the default the HID specification recommends for mice.  Entry zero
+ * holds the rate last set for all reports, for GET_IDLE, and the boot
+ * report follows the pointer report's rate.  The time since each
+ * report was last sent is counted in milliseconds, in the SOF
+ * interrupt. */
+
+static uint8_t idle_rates[REPORT_ID_SCROLL + 1];
+static volatile uint16_t idle_elapsed[REPORT_ID_SCROLL + 1];
+
+static void process_idle_request(void)
+{
+    const uint8_t id = USB_ControlRequest.wValue & 0xff;
+
+    if (!Endpoint_IsSETUPReceived()
+        || USB_ControlRequest.wIndex != INTERFACE_ID_Mouse) {
+        return;
+    }
+
+    switch (USB_ControlRequest.bRequest) {
+    case HID_REQ_SetIdle:
+        if (USB_ControlRequest.bmRequestType
+            != (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE)) {
+            return;
+        }
+
+        break;
+
+    case HID_REQ_GetIdle:
+        if (USB_ControlRequest.bmRequestType
+            != (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE)) {
+            return;
+        }
+
+        break;
+
+    default:
+        return;
+    }
+
+    /* Only input reports have an idle rate. */
+
+    if (id >= sizeof(idle_rates)) {
+        Endpoint_StallTransaction();
+        Endpoint_ClearSETUP();
+
+        return;
+    }
+
+    Endpoint_ClearSETUP();
+
+    if (USB_ControlRequest.bRequest == HID_REQ_SetIdle) {
+        const uint8_t r = USB_ControlRequest.wValue >> 8;
+
+        Endpoint_ClearStatusStage();
+
+        /* The new rate takes effect from the last report, so that a
+         * report is due at once, if more time than the new rate has
+         * already passed. */
+
+        if (id == 0) {
+            memset(idle_rates, r, sizeof(idle_rates));
+        } else {
+            idle_rates[id] = r;
+        }
+    } else {
+        while (!Endpoint_IsINReady());
+        Endpoint_Write_8(idle_rates[id]);
+        Endpoint_ClearIN();
+        Endpoint_ClearStatusStage();
+    }
+}
+
+/* Whether the report with the given ID is due to be sent again,
+ * unchanged, because its idle period has elapsed. */
+
+static bool idle_due(uint8_t id)
+{
+    uint16_t t;
+
+    if (idle_rates[id] == 0) {
+        return false;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        t = idle_elapsed[id];
+    }
+
+    return (t >= idle_rates[id] * 4U);
+}
+
+static void restart_idle(uint8_t id)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        idle_elapsed[id] = 0;
+    }
+}
+
 void do_usb_tasks(void)
 {
 #ifdef ENABLE_CDC
+    PROFILE_BEGIN(PROFILE_CDC);
     CDC_Device_USBTask(&CDC_Interface);
+    PROFILE_END(PROFILE_CDC);
 #endif
 
+    PROFILE_BEGIN(PROFILE_HID);
     HID_Device_USBTask(&HID_Interface);
+    PROFILE_END(PROFILE_HID);
+
+#ifdef KEY_MAP
+    HID_Device_USBTask(&Keyboard_Interface);
+#endif
+
+#ifdef ENABLE_TELEMETRY
+    HID_Device_USBTask(&Telemetry_Interface);
+#endif
+
+    /* When control requests are serviced from the USB interrupt,
+     * there's nothing left for USB_USBTask to do. */
+
+#ifndef INTERRUPT_CONTROL_ENDPOINT
+    PROFILE_BEGIN(PROFILE_USB);
     USB_USBTask();
+    PROFILE_END(PROFILE_USB);
+#endif
+
+    /* A jump is requested from a control request, but only carried
+     * out here, after the request has been completed. */
+
+#ifdef ENABLE_BOOTLOADER_JUMP
+    if (jump_requested) {
+        jump_to_bootloader();
+    }
+#endif
 }
 
 void EVENT_USB_Device_Connect(void)
@@ -516,8 +856,33 @@ void EVENT_USB_Device_Disconnect(void)
 
 void EVENT_USB_Device_ConfigurationChanged(void)
 {
+    void set_wheel_multiplier(uint8_t m);
+
     assert(HID_Device_ConfigureEndpoints(&HID_Interface));
 
+    /* Reset the mouse's idle rates to their default (see above), and
+     * leave idling to the report callback. */
+
+    HID_Interface.State.IdleCount = 0;
+    memset(idle_rates, 0, sizeof(idle_rates));
+
+    for (uint8_t i = 0; i < sizeof(idle_rates); i++) {
+        idle_elapsed[i] = 0;
+    }
+
+    /* The resolution multiplier reverts to its default too, until the
+     * host sets it. */
+
+    set_wheel_multiplier(0);
+
+#ifdef KEY_MAP
+    assert(HID_Device_ConfigureEndpoints(&Keyboard_Interface));
+#endif
+
+#ifdef ENABLE_TELEMETRY
+    assert(HID_Device_ConfigureEndpoints(&Telemetry_Interface));
+#endif
+
 #ifdef ENABLE_CDC
     assert(CDC_Device_ConfigureEndpoints(&CDC_Interface));
 #endif
@@ -525,18 +890,61 @@ void EVENT_USB_Device_ConfigurationChanged(void)
     USB_Device_EnableSOFEvents();
 }
 
+/* With INTERRUPT_CONTROL_ENDPOINT, this, and everything it calls,
+ * runs in the USB interrupt, with interrupts enabled, and can preempt
+ * the main loop anywhere.  LUFA saves and restores the selected
+ * endpoint, so it's safe to preempt the IN endpoint tasks, and the
+ * sensor's SPI timing is only ever stretched, which is harmless, as all
+ * its constraints are minimums.  The callbacks below must therefore only
+ * read state that can't be torn (see get_resolution), and must not
+ * consume motion, which is reserved for the IN endpoint. */
+
+static volatile bool in_control_request;
+
 void EVENT_USB_Device_ControlRequest(void)
 {
+    PROFILE_BEGIN(PROFILE_CONTROL);
+    in_control_request = true;
+
 #ifdef ENABLE_CDC
     CDC_Device_ProcessControlRequest(&CDC_Interface);
 #endif
 
+    process_idle_request();
     HID_Device_ProcessControlRequest(&HID_Interface);
+
+#ifdef KEY_MAP
+    HID_Device_ProcessControlRequest(&Keyboard_Interface);
+#endif
+
+#ifdef ENABLE_TELEMETRY
+    HID_Device_ProcessControlRequest(&Telemetry_Interface);
+#endif
+
+#ifdef ENABLE_PROFILER
+    profile_process_control_request();
+    memory_process_control_request();
+#endif
+
+    in_control_request = false;
+    PROFILE_END(PROFILE_CONTROL);
 }
 
 void EVENT_USB_Device_StartOfFrame(void)
 {
-    HID_Device_MillisecondElapsed(&HID_Interface);
+    for (uint8_t i = 0; i < sizeof(idle_rates); i++) {
+        if (idle_elapsed[i] < UINT16_MAX) {
+            idle_elapsed[i] += 1;
+        }
+    }
+
+#ifdef KEY_MAP
+    HID_Device_MillisecondElapsed(&Keyboard_Interface);
+#endif
+
+#ifdef ENABLE_TELEMETRY
+    HID_Device_MillisecondElapsed(&Telemetry_Interface);
+#endif
 }
 
 bool CALLBACK_HID_Device_CreateHIDReport(
@@ -546,65 +954,165 @@ bool CALLBACK_HID_Device_CreateHIDReport(
     void* ReportData,
     uint16_t *const ReportSize)
 {
-    if (ReportType == HID_REPORT_ITEM_Feature) {
-        static bool set;
+#ifdef KEY_MAP
+    if (HIDInterfaceInfo == &Keyboard_Interface) {
+        void get_keys(USB_KeyboardReport_Data_t *p);
+
+        *ReportSize = sizeof(USB_KeyboardReport_Data_t);
+        get_keys((USB_KeyboardReport_Data_t *)ReportData);
+
+        return false;
+    }
+#endif
 
-        if (set) {
+#ifdef ENABLE_TELEMETRY
+    if (HIDInterfaceInfo == &Telemetry_Interface) {
+        *ReportSize = sizeof(struct telemetry);
+
+        /* Leave the report empty for GET_REPORT requests, so as not
+         * to disturb the stream. */
+
+        if (in_control_request) {
             return false;
         }
 
+        return get_telemetry((struct telemetry *)ReportData);
+    }
+#endif
+
+#ifdef ENABLE_BOOTLOADER_JUMP
+    /* The bootloader report always reads as zero. */
+
+    if (ReportType == HID_REPORT_ITEM_Feature
+        && *ReportID == REPORT_ID_BOOTLOADER) {
+        *ReportSize = sizeof(BootloaderReport_Data_t);
+
+        return false;
+    }
+#endif
+
+    if (ReportType == HID_REPORT_ITEM_Feature) {
+        void get_resolution(uint16_t *cpi, uint16_t *latency);
+        uint8_t get_wheel_multiplier(void);
+
         FeatureReport_Data_t *p = (FeatureReport_Data_t *)ReportData;
+        *ReportID = REPORT_ID_FEATURE;
         *ReportSize = sizeof(FeatureReport_Data_t);
-        p->multiplier = 1;
-        set = true;
+        p->multiplier = get_wheel_multiplier();
+        get_resolution(&p->resolution, &p->latency);
 
         return true;
     } else {
-        bool get_axes(int16_t *p);
-        static uint8_t old_buttons, new_buttons, debounce_count;
+        bool get_axes(int16_t *p, int16_t limit);
+        bool split_axes(int16_t *p, bool pointer, bool scroll);
+        uint8_t get_buttons(void);
         const uint8_t buttons[] = {BUTTONS};
+        const bool boot = !HIDInterfaceInfo->State.UsingReportProtocol;
+        static uint8_t reported;
+        int16_t a[4] = {0, 0, 0, 0};
+        uint8_t m = 0;
+
+        /* Read the current axes and button state and create the
+         * report.  The buttons are debounced separately, by their
+         * own task, so just check whether the reported ones have
+         * changed since the last report. */
+
+#ifdef KEY_MAP
+        uint8_t get_key_buttons(void);
+        const uint8_t b = get_buttons() & ~get_key_buttons();
+#else
+        const uint8_t b = get_buttons();
+#endif
 
-        MouseReport_Data_t *p = (MouseReport_Data_t *)ReportData;
-        *ReportSize = sizeof(MouseReport_Data_t);
-
-        /* Read the current axes state and create the report. */
+        for (uint8_t i = 0; i < sizeof(buttons); i++) {
+            m |= (((b & (1 << buttons[i])) != 0) << i);
+        }
 
-        p->buttons = old_buttons;
-        const bool q = get_axes(p->axes);
+        /* A GET_REPORT request gets the current button state, but no
+         * motion, which is left to be reported on the IN endpoint.
+         * Nor does it count as a report of the buttons. */
 
-        /* Read the current button state. */
+        if (in_control_request) {
+            if (boot) {
+                *ReportSize = sizeof(BootReport_Data_t);
+                ((BootReport_Data_t *)ReportData)->buttons = m & 0x07;
+            } else if (*ReportID == REPORT_ID_SCROLL) {
+                *ReportSize = sizeof(ScrollReport_Data_t);
+            } else {
+                *ReportID = REPORT_ID_POINTER;
+                *ReportSize = sizeof(PointerReport_Data_t);
+                ((PointerReport_Data_t *)ReportData)->buttons = m;
+            }
 
-        uint8_t b = 0;
-        for (uint8_t i = 0; i < sizeof(buttons); i++) {
-            b |= (((PIND & (1 << buttons[i])) == 0) << i);
+            return false;
         }
 
-        if (!debounce_count) {
-            /* If the button state changed, start debouncing. */
+        get_axes(a, boot ? INT8_MAX : INT16_MAX);
 
-            if (b != old_buttons) {
-                new_buttons = b;
-                debounce_count = 1;
-            }
-        } else {
-            /* Is the new button state stable? */
+        /* Only buttons that appear in the report count as changes.
+         * The boot protocol report only has the first three. */
 
-            if (b == new_buttons) {
-                debounce_count += 1;
-            } else {
-                debounce_count = 1;
-            }
+        const bool c = ((m ^ reported) & (boot ? 0x07 : 0xff)) != 0;
+
+        if (boot) {
+            /* The boot protocol report has no wheels, so any wheel
+             * motion is dropped. */
+
+            BootReport_Data_t *p = (BootReport_Data_t *)ReportData;
+            *ReportSize = sizeof(BootReport_Data_t);
+
+            p->buttons = m & 0x07;
+            p->x = a[0];
+            p->y = a[1];
 
-            if (debounce_count > DEBOUNCE_INTERVAL) {
-                /* Update the button state. */
+            reported = m;
+
+            if (a[0] || a[1] || c || idle_due(REPORT_ID_POINTER)) {
+                restart_idle(REPORT_ID_POINTER);
 
-                p->buttons = old_buttons = new_buttons;
-                debounce_count = 0;
                 return true;
             }
+
+            return false;
         }
 
-        return q;
+        /* Send whichever report has changed, or is due to be sent
+         * again, unchanged.  Both can be, when switching between
+         * pointing and scrolling, when idling, or, with a twist
+         * sensor, when the ball is twisted while it's rolled (see
+         * update_twist), in which case split_axes() alternates
+         * between them. */
+
+        const bool pointer = (a[0] || a[1] || c
+                              || idle_due(REPORT_ID_POINTER));
+        const bool scroll = (a[2] || a[3] || idle_due(REPORT_ID_SCROLL));
+
+        if (split_axes(a, pointer, scroll)) {
+            ScrollReport_Data_t *p = (ScrollReport_Data_t *)ReportData;
+            *ReportID = REPORT_ID_SCROLL;
+            *ReportSize = sizeof(ScrollReport_Data_t);
+
+            p->axes[0] = a[2];
+            p->axes[1] = a[3];
+        } else {
+            PointerReport_Data_t *p = (PointerReport_Data_t *)ReportData;
+            *ReportID = REPORT_ID_POINTER;
+            *ReportSize = sizeof(PointerReport_Data_t);
+
+            p->buttons = m;
+            p->axes[0] = a[0];
+            p->axes[1] = a[1];
+
+            reported = m;
+        }
+
+        if (*ReportID == REPORT_ID_SCROLL ? scroll : pointer) {
+            restart_idle(*ReportID);
+
+            return true;
+        }
+
+        return false;
     }
 }
 
@@ -615,6 +1123,31 @@ void CALLBACK_HID_Device_ProcessHIDReport(
     const void* ReportData,
     const uint16_t ReportSize)
 {
+    if (HIDInterfaceInfo != &HID_Interface
+        || ReportType != HID_REPORT_ITEM_Feature) {
+        return;
+    }
+
+    /* Only the resolution multiplier, in the low two bits of the first
+     * byte, is writable in the feature report. */
+
+    if (ReportID == REPORT_ID_FEATURE
+        && ReportSize == sizeof(FeatureReport_Data_t)) {
+        void set_wheel_multiplier(uint8_t m);
+        const FeatureReport_Data_t *p = ReportData;
+
+        set_wheel_multiplier((p->multiplier & 0x03) != 0);
+    }
+
+#ifdef ENABLE_BOOTLOADER_JUMP
+    const BootloaderReport_Data_t *p = ReportData;
+
+    if (ReportID == REPORT_ID_BOOTLOADER
+        && ReportSize == sizeof(BootloaderReport_Data_t)
+        && p->key == BOOTLOADER_KEY) {
+        jump_requested = true;
+    }
+#endif
 }
 
 #ifdef ENABLE_CDC
@@ -653,6 +1186,13 @@ void initialize_usb(void)
 #endif
 }
 
+/* Whether the host has suspended the bus. */
+
+bool host_suspended(void)
+{
+    return (USB_DeviceState == DEVICE_STATE_Suspended);
+}
+
 void wait_for_host(void)
 {
 #ifdef ENABLE_CDC